@@ -0,0 +1,57 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "threadpool.h"
+#include "bench.h"
+
+/*
+ * Allocation rate under steady submission:
+ * trips to malloc per 1000 tasks, for the first round and for the last one.
+ *
+ * usage: bench_alloc [threads] [tasks per round] [rounds]
+ */
+
+static void nothing(void *args)
+{
+	(void)args;
+}
+
+static double mallocs_per_k(pool_alloc_stats *before, pool_alloc_stats *after, int tasks)
+{
+	long chunks = after->task_chunks - before->task_chunks
+		+ after->node_chunks - before->node_chunks;
+	return chunks * 1000.0 / tasks;
+}
+
+int main(int argc, char **argv)
+{
+	int threads_num = bench_arg(argc, argv, 1, 4);
+	int tasks_num = bench_arg(argc, argv, 2, 100000);
+	int rounds = bench_arg(argc, argv, 3, 10);
+
+	threadpool tp = pool_create(threads_num);
+	pool_alloc_stats before = { 0 };
+	pool_alloc_stats after;
+
+	for (int round = 0; round < rounds; round++) {
+		double start = bench_now();
+		for (int i = 0; i < tasks_num; i++)
+			pool_add_task(tp, nothing, NULL);
+		pool_wait(tp);
+		double elapsed = bench_now() - start;
+
+		pool_get_alloc_stats(tp, &after);
+		if (round == 0)
+			bench_report("alloc", "first_round_mallocs_per_1k", mallocs_per_k(&before, &after, tasks_num), "");
+		if (round == rounds - 1) {
+			bench_report("alloc", "last_round_mallocs_per_1k", mallocs_per_k(&before, &after, tasks_num), "");
+			bench_report("alloc", "last_round_throughput", tasks_num / elapsed / 1e6, "Mtasks/s");
+		}
+		before = after;
+	}
+
+	bench_report("alloc", "total_task_chunks", after.task_chunks, "");
+	bench_report("alloc", "total_node_chunks", after.node_chunks, "");
+	pool_destroy(tp);
+	return 0;
+}
@@ -0,0 +1,50 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "platform.h"
+#include "bench.h"
+
+static int compare_double(const void *a, const void *b);
+
+double bench_now(void)
+{
+	return (double)os_now_ns() / 1e9;
+}
+
+void bench_spin(double seconds)
+{
+	double until = bench_now() + seconds;
+	while (bench_now() < until)
+		;
+}
+
+static int compare_double(const void *a, const void *b)
+{
+	double da = *(const double *)a;
+	double db = *(const double *)b;
+	return (da > db) - (da < db);
+}
+
+double bench_percentile(double *values, int n, double p)
+{
+	if (n <= 0)
+		return 0;
+	qsort(values, n, sizeof(double), compare_double);
+
+	int i = (int)(p / 100.0 * (n - 1) + 0.5);
+	return values[i];
+}
+
+int bench_arg(int argc, char **argv, int i, int def)
+{
+	if (i >= argc)
+		return def;
+	return atoi(argv[i]);
+}
+
+void bench_report(const char *bench, const char *metric, double value, const char *unit)
+{
+	// a unit of its own even for plain counts, so every line has as many fields
+	printf("%-12s %-28s %14.3f %s\n", bench, metric, value, unit[0] != '\0' ? unit : "-");
+	fflush(stdout);
+}
@@ -0,0 +1,34 @@
+#ifndef H_BENCH
+#define H_BENCH
+/*
+ * Bits shared by the benchmarks, not part of the library
+ */
+
+/*
+ * Monotonic, in seconds
+ */
+double bench_now(void);
+
+/*
+ * Burns CPU for the given time, a stand-in for real work
+ */
+void bench_spin(double seconds);
+
+/*
+ * Sorts values in place
+ * p is in [0, 100]
+ */
+double bench_percentile(double *values, int n, double p);
+
+/*
+ * Returns:
+ *	argv[i] as an integer, def if there is no such argument
+ */
+int bench_arg(int argc, char **argv, int i, int def);
+
+/*
+ * One result per line: bench metric value unit, "-" for none
+ */
+void bench_report(const char *bench, const char *metric, double value, const char *unit);
+
+#endif
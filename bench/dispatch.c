@@ -0,0 +1,152 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "threadpool.h"
+#include "bench.h"
+
+/*
+ * How outside submitters pick a worker. Mixed durations first: most tasks
+ * are short, some are long, added at a steady pace that keeps the workers
+ * about 70% busy, once with round-robin and once with two choices.
+ * Then keyed tasks: every task reads the buffer of its key, added with
+ * pool_add_task_keyed and then with pool_add_task, same keys in the same order.
+ *
+ * usage: bench_dispatch [threads] [tasks] [short_us] [long_us] [long_percent] [key_kib]
+ */
+
+typedef struct __job {
+	double duration;
+	double added;
+	double latency;
+} t_job, *p_job;
+
+typedef struct __keyed {
+	const long *buffer;
+	long sum;
+} t_keyed, *p_keyed;
+
+static int buffer_len;
+
+static void run_job(void *args)
+{
+	p_job job = (p_job)args;
+	bench_spin(job->duration);
+	job->latency = bench_now() - job->added;
+}
+
+static void run_keyed(void *args)
+{
+	p_keyed keyed = (p_keyed)args;
+	long sum = 0;
+	for (int i = 0; i < buffer_len; i++)
+		sum += keyed->buffer[i];
+	keyed->sum = sum;
+}
+
+static void mixed(const char *name, int dispatch, int threads_num, p_job jobs, int tasks_num, double gap)
+{
+	pool_options options;
+	pool_options_init(&options, threads_num);
+	options.dispatch = dispatch;
+	threadpool tp = pool_create_ex(&options);
+
+	double start = bench_now();
+	for (int i = 0; i < tasks_num; i++) {
+		bench_spin(gap);
+		jobs[i].added = bench_now();
+		pool_add_task(tp, run_job, &jobs[i]);
+	}
+	pool_wait(tp);
+	double makespan = bench_now() - start;
+	pool_destroy(tp);
+
+	double *latency = malloc(tasks_num * sizeof(double));
+	if (latency == NULL) {
+		fprintf(stderr, "malloc: NULL\n");
+		exit(1);
+	}
+	for (int i = 0; i < tasks_num; i++)
+		latency[i] = jobs[i].latency;
+
+	char metric[64];
+	snprintf(metric, sizeof(metric), "%s_makespan", name);
+	bench_report("dispatch", metric, makespan * 1e3, "ms");
+	snprintf(metric, sizeof(metric), "%s_latency_p50", name);
+	bench_report("dispatch", metric, bench_percentile(latency, tasks_num, 50) * 1e6, "us");
+	snprintf(metric, sizeof(metric), "%s_latency_p99", name);
+	bench_report("dispatch", metric, bench_percentile(latency, tasks_num, 99) * 1e6, "us");
+	free(latency);
+}
+
+static double keyed(threadpool tp, int by_key, p_keyed tasks, const int *keys, int tasks_num)
+{
+	double start = bench_now();
+	for (int i = 0; i < tasks_num; i++)
+		if (by_key)
+			pool_add_task_keyed(tp, (unsigned long)keys[i], run_keyed, &tasks[i]);
+		else
+			pool_add_task(tp, run_keyed, &tasks[i]);
+	pool_wait(tp);
+	return bench_now() - start;
+}
+
+int main(int argc, char **argv)
+{
+	int threads_num = bench_arg(argc, argv, 1, 4);
+	int tasks_num = bench_arg(argc, argv, 2, 20000);
+	double short_task = bench_arg(argc, argv, 3, 20) / 1e6;
+	double long_task = bench_arg(argc, argv, 4, 1000) / 1e6;
+	int long_percent = bench_arg(argc, argv, 5, 10);
+	int key_kib = bench_arg(argc, argv, 6, 256);
+
+	p_job jobs = malloc(tasks_num * sizeof(t_job));
+	if (jobs == NULL) {
+		fprintf(stderr, "malloc: NULL\n");
+		return 1;
+	}
+
+	// same durations for both, in the same order
+	srand(1);
+	double total = 0;
+	for (int i = 0; i < tasks_num; i++) {
+		jobs[i].duration = rand() % 100 < long_percent ? long_task : short_task;
+		total += jobs[i].duration;
+	}
+	double gap = total / tasks_num / threads_num / 0.7;
+
+	mixed("round_robin", POOL_DISPATCH_ROUND_ROBIN, threads_num, jobs, tasks_num, gap);
+	mixed("two_choices", POOL_DISPATCH_TWO_CHOICES, threads_num, jobs, tasks_num, gap);
+	free(jobs);
+
+	// a few keys per worker, each worth a good part of a core's cache
+	int keys_num = threads_num * 4;
+	buffer_len = key_kib * 1024 / (int)sizeof(long);
+	long *buffers = malloc((size_t)keys_num * buffer_len * sizeof(long));
+	p_keyed tasks = malloc(tasks_num * sizeof(t_keyed));
+	int *keys = malloc(tasks_num * sizeof(int));
+	if (buffers == NULL || tasks == NULL || keys == NULL) {
+		fprintf(stderr, "malloc: NULL\n");
+		return 1;
+	}
+	for (long i = 0; i < (long)keys_num * buffer_len; i++)
+		buffers[i] = i;
+	for (int i = 0; i < tasks_num; i++) {
+		keys[i] = rand() % keys_num;
+		tasks[i].buffer = buffers + (size_t)keys[i] * buffer_len;
+	}
+
+	threadpool tp = pool_create(threads_num);
+	// the first pass warms up whatever it is going to find
+	keyed(tp, 0, tasks, keys, tasks_num);
+	double unkeyed = keyed(tp, 0, tasks, keys, tasks_num);
+	double by_key = keyed(tp, 1, tasks, keys, tasks_num);
+	pool_destroy(tp);
+
+	bench_report("dispatch", "unkeyed_throughput", tasks_num / unkeyed / 1e3, "Ktasks/s");
+	bench_report("dispatch", "keyed_throughput", tasks_num / by_key / 1e3, "Ktasks/s");
+
+	free(keys);
+	free(tasks);
+	free(buffers);
+	return 0;
+}
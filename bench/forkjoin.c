@@ -0,0 +1,60 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "threadpool.h"
+#include "bench.h"
+
+/*
+ * Fork-join with the basic calls only, so it builds against
+ * versions/threadpool_one_queue.c as well: rounds of fan_out empty tasks
+ * added one by one and waited for with pool_wait, then the round trip
+ * of a single empty task the same way.
+ *
+ * usage: bench_forkjoin [threads] [fan_out] [rounds]
+ */
+
+static void empty(void *args)
+{
+	(void)args;
+}
+
+int main(int argc, char **argv)
+{
+	int threads_num = bench_arg(argc, argv, 1, 4);
+	int fan_out = bench_arg(argc, argv, 2, 1000);
+	int rounds = bench_arg(argc, argv, 3, 1000);
+
+	double *latency = malloc(rounds * sizeof(double));
+	if (latency == NULL) {
+		fprintf(stderr, "malloc: NULL\n");
+		return 1;
+	}
+
+	threadpool tp = pool_create(threads_num);
+
+	double start = bench_now();
+	for (int i = 0; i < rounds; i++) {
+		double round = bench_now();
+		for (int j = 0; j < fan_out; j++)
+			pool_add_task(tp, empty, NULL);
+		pool_wait(tp);
+		latency[i] = bench_now() - round;
+	}
+	double elapsed = bench_now() - start;
+	bench_report("forkjoin", "fan_out_throughput", (double)rounds * fan_out / elapsed / 1e6, "Mtasks/s");
+	bench_report("forkjoin", "fan_out_round_p50", bench_percentile(latency, rounds, 50) * 1e6, "us");
+	bench_report("forkjoin", "fan_out_round_p99", bench_percentile(latency, rounds, 99) * 1e6, "us");
+
+	for (int i = 0; i < rounds; i++) {
+		double round = bench_now();
+		pool_add_task(tp, empty, NULL);
+		pool_wait(tp);
+		latency[i] = bench_now() - round;
+	}
+	bench_report("forkjoin", "single_p50", bench_percentile(latency, rounds, 50) * 1e6, "us");
+	bench_report("forkjoin", "single_p99", bench_percentile(latency, rounds, 99) * 1e6, "us");
+
+	pool_destroy(tp);
+	free(latency);
+	return 0;
+}
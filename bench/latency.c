@@ -0,0 +1,68 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "threadpool.h"
+#include "bench.h"
+
+/*
+ * Round trip of a single empty task: pool_submit, then future_wait
+ * from outside of the pool. The submitter pauses between rounds,
+ * so workers are idle every time, spinning or asleep depending on the spin.
+ * Reported with spinning off and with the given spin.
+ *
+ * usage: bench_latency [threads] [rounds] [gap_us] [spin_us]
+ */
+
+static void* empty(void *args)
+{
+	return args;
+}
+
+static void run(threadpool tp, int rounds, double gap, double *latency)
+{
+	for (int i = 0; i < rounds; i++) {
+		bench_spin(gap);
+		double start = bench_now();
+		future done = pool_submit(tp, empty, NULL);
+		future_wait(done);
+		latency[i] = bench_now() - start;
+		future_release(done);
+	}
+}
+
+static void report(const char *name, double *latency, int rounds)
+{
+	char metric[64];
+	snprintf(metric, sizeof(metric), "%s_p50", name);
+	bench_report("latency", metric, bench_percentile(latency, rounds, 50) * 1e6, "us");
+	snprintf(metric, sizeof(metric), "%s_p99", name);
+	bench_report("latency", metric, bench_percentile(latency, rounds, 99) * 1e6, "us");
+}
+
+int main(int argc, char **argv)
+{
+	int threads_num = bench_arg(argc, argv, 1, 4);
+	int rounds = bench_arg(argc, argv, 2, 10000);
+	double gap = bench_arg(argc, argv, 3, 20) / 1e6;
+	int spin = bench_arg(argc, argv, 4, 50);
+
+	double *latency = malloc(rounds * sizeof(double));
+	if (latency == NULL) {
+		fprintf(stderr, "malloc: NULL\n");
+		return 1;
+	}
+
+	threadpool tp = pool_create(threads_num);
+
+	pool_set_spin(tp, 0);
+	run(tp, rounds, gap, latency);
+	report("park", latency, rounds);
+
+	pool_set_spin(tp, spin);
+	run(tp, rounds, gap, latency);
+	report("spin", latency, rounds);
+
+	pool_destroy(tp);
+	free(latency);
+	return 0;
+}
@@ -0,0 +1,91 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "threadpool.h"
+#include "bench.h"
+
+/*
+ * Overhead of pool_parallel_for / pool_parallel_reduce on a tiny loop body:
+ * time per iteration against a plain loop, for a few grain sizes.
+ * The 1-thread numbers are pure overhead, nothing runs in parallel there.
+ *
+ * usage: bench_parallel_for [threads] [iterations] [rounds]
+ */
+
+static long *values;
+
+static void add_one(long begin, long end, void *ctx)
+{
+	(void)ctx;
+	for (long i = begin; i < end; i++)
+		values[i]++;
+}
+
+static void sum(long begin, long end, void *acc, void *ctx)
+{
+	(void)ctx;
+	long s = 0;
+	for (long i = begin; i < end; i++)
+		s += values[i];
+	*(long *)acc += s;
+}
+
+static void combine(void *acc, const void *other, void *ctx)
+{
+	(void)ctx;
+	*(long *)acc += *(const long *)other;
+}
+
+int main(int argc, char **argv)
+{
+	int threads_num = bench_arg(argc, argv, 1, 4);
+	long n = bench_arg(argc, argv, 2, 10000000);
+	int rounds = bench_arg(argc, argv, 3, 5);
+	static const long grains[] = { 1, 16, 256, 4096 };
+	char metric[64];
+
+	values = calloc(n, sizeof(long));
+	if (values == NULL) {
+		fprintf(stderr, "malloc: NULL\n");
+		return 1;
+	}
+
+	// fault the pages in first, or the plain loop pays for them
+	add_one(0, n, NULL);
+	double start = bench_now();
+	for (int round = 0; round < rounds; round++)
+		add_one(0, n, NULL);
+	double plain = (bench_now() - start) / rounds / n;
+	bench_report("parallel_for", "plain_loop", plain * 1e9, "ns/iter");
+
+	threadpool tp = pool_create(threads_num);
+	for (size_t g = 0; g < sizeof(grains) / sizeof(grains[0]); g++) {
+		start = bench_now();
+		for (int round = 0; round < rounds; round++)
+			pool_parallel_for(tp, 0, n, grains[g], add_one, NULL);
+		double elapsed = (bench_now() - start) / rounds / n;
+		snprintf(metric, sizeof(metric), "for_grain_%ld", grains[g]);
+		bench_report("parallel_for", metric, elapsed * 1e9, "ns/iter");
+	}
+
+	long expected = 0;
+	for (long i = 0; i < n; i++)
+		expected += values[i];
+	for (size_t g = 0; g < sizeof(grains) / sizeof(grains[0]); g++) {
+		long result = 0;
+		start = bench_now();
+		for (int round = 0; round < rounds; round++) {
+			result = 0;
+			pool_parallel_reduce(tp, 0, n, grains[g], sum, combine, &result, sizeof(result), NULL);
+		}
+		double elapsed = (bench_now() - start) / rounds / n;
+		if (result != expected)
+			fprintf(stderr, "parallel_reduce: got %ld, expected %ld\n", result, expected);
+		snprintf(metric, sizeof(metric), "reduce_grain_%ld", grains[g]);
+		bench_report("parallel_for", metric, elapsed * 1e9, "ns/iter");
+	}
+	pool_destroy(tp);
+
+	free(values);
+	return 0;
+}
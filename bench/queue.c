@@ -0,0 +1,83 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "platform.h"
+#include "queue.h"
+#include "bench.h"
+
+/*
+ * Raw q_enque/q_deque throughput, N producers and M consumers,
+ * the locked list against the bounded ring.
+ *
+ * usage: bench_queue [producers] [consumers] [ops per producer] [capacity]
+ */
+
+typedef struct __side {
+	queue q;
+	int ops;
+} t_side, *p_side;
+
+static void produce(void *args)
+{
+	p_side side = (p_side)args;
+	for (long i = 1; i <= side->ops; i++)
+		while (q_enque(side->q, (void *)i) == Q_FULL)
+			os_thread_yield();
+}
+
+static void consume(void *args)
+{
+	p_side side = (p_side)args;
+	void *data = (void *)1;
+	// NULL is the stop marker
+	while (data != NULL)
+		if (q_try_deque(side->q, &data) != Q_OK) {
+			data = (void *)1;
+			os_thread_yield();
+		}
+}
+
+static double run(queue q, int producers, int consumers, int ops)
+{
+	t_side side = { q, ops };
+
+	os_thread *threads = malloc((producers + consumers) * sizeof(os_thread));
+	if (threads == NULL) {
+		fprintf(stderr, "malloc: NULL\n");
+		exit(1);
+	}
+
+	double start = bench_now();
+	for (int i = 0; i < consumers; i++)
+		os_thread_create(&threads[i], consume, &side);
+	for (int i = 0; i < producers; i++)
+		os_thread_create(&threads[consumers + i], produce, &side);
+	for (int i = 0; i < producers; i++)
+		os_thread_join(threads[consumers + i]);
+	for (int i = 0; i < consumers; i++)
+		while (q_enque(q, NULL) == Q_FULL)
+			os_thread_yield();
+	for (int i = 0; i < consumers; i++)
+		os_thread_join(threads[i]);
+	double elapsed = bench_now() - start;
+
+	free(threads);
+	return (double)producers * ops / elapsed / 1e6;
+}
+
+int main(int argc, char **argv)
+{
+	int producers = bench_arg(argc, argv, 1, 4);
+	int consumers = bench_arg(argc, argv, 2, 4);
+	int ops = bench_arg(argc, argv, 3, 1000000);
+	int capacity = bench_arg(argc, argv, 4, 1024);
+
+	queue list = q_create();
+	bench_report("queue", "list_throughput", run(list, producers, consumers, ops), "Mops/s");
+	q_destroy(list);
+
+	queue ring = q_create_bounded(capacity);
+	bench_report("queue", "bounded_throughput", run(ring, producers, consumers, ops), "Mops/s");
+	q_destroy(ring);
+	return 0;
+}
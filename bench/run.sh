@@ -0,0 +1,38 @@
+#!/bin/sh
+# Runs every benchmark of a build directory, one result per line:
+#	run bench metric value unit
+# where run names the executable and its arguments, e.g. queue_4x4
+# The lines starting with # say what was measured where, so two runs
+# (two commits, two machines) can be diffed or loaded as they are.
+#
+# usage: bench/run.sh [build dir] [output file]
+
+build=${1:-_build}
+output=${2:-/dev/stdout}
+threads=${THREADS:-$(nproc 2>/dev/null || echo 4)}
+
+run() {
+	label=$1
+	name=$2
+	shift 2
+	"$build/$name" "$@" | sed "s/^/$label /"
+}
+
+{
+	echo "# commit $(git rev-parse --short HEAD 2>/dev/null || echo unknown)"
+	echo "# date $(date -u +%Y-%m-%dT%H:%M:%SZ)"
+	echo "# host $(uname -srm), $threads threads"
+
+	run queue_1x1 bench_queue 1 1 1000000
+	run queue_${threads}x$threads bench_queue "$threads" "$threads" 1000000
+	run latency bench_latency "$threads" 10000
+	run forkjoin bench_forkjoin "$threads" 1000 1000
+	run forkjoin_one_queue bench_forkjoin_one_queue "$threads" 1000 1000
+	run skew bench_skew "$threads" 400
+	run skew_one_queue bench_skew_one_queue "$threads" 400
+	run dispatch bench_dispatch "$threads"
+	run parallel_for bench_parallel_for "$threads"
+	run alloc bench_alloc "$threads"
+	run timers bench_timers "$threads"
+	run sort bench_sort "$threads"
+} > "$output"
@@ -0,0 +1,78 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "threadpool.h"
+#include "bench.h"
+
+/*
+ * Skewed workload: every threads_num-th task is heavy,
+ * so round-robin dispatch lands all of them on the same worker.
+ * Reports completion latency percentiles next to the makespan
+ * round-robin without stealing could achieve at best.
+ *
+ * usage: bench_skew [threads] [tasks] [light_us] [heavy_us]
+ */
+
+typedef struct __job {
+	double duration;
+	double end;
+} t_job, *p_job;
+
+static double start;
+
+static void run_job(void *args)
+{
+	p_job job = (p_job)args;
+	bench_spin(job->duration);
+	job->end = bench_now() - start;
+}
+
+int main(int argc, char **argv)
+{
+	int threads_num = bench_arg(argc, argv, 1, 4);
+	int tasks_num = bench_arg(argc, argv, 2, 400);
+	double light = bench_arg(argc, argv, 3, 100) / 1e6;
+	double heavy = bench_arg(argc, argv, 4, 2000) / 1e6;
+
+	p_job jobs = malloc(tasks_num * sizeof(t_job));
+	double *latency = malloc(tasks_num * sizeof(double));
+	double *per_worker = calloc(threads_num, sizeof(double));
+	if (jobs == NULL || latency == NULL || per_worker == NULL) {
+		fprintf(stderr, "malloc: NULL\n");
+		return 1;
+	}
+
+	double total = 0;
+	for (int i = 0; i < tasks_num; i++) {
+		jobs[i].duration = i % threads_num == 0 ? heavy : light;
+		total += jobs[i].duration;
+		per_worker[i % threads_num] += jobs[i].duration;
+	}
+	double round_robin = 0;
+	for (int i = 0; i < threads_num; i++)
+		if (per_worker[i] > round_robin)
+			round_robin = per_worker[i];
+
+	threadpool tp = pool_create(threads_num);
+	start = bench_now();
+	for (int i = 0; i < tasks_num; i++)
+		pool_add_task(tp, run_job, &jobs[i]);
+	pool_wait(tp);
+	double makespan = bench_now() - start;
+	pool_destroy(tp);
+
+	for (int i = 0; i < tasks_num; i++)
+		latency[i] = jobs[i].end;
+
+	bench_report("skew", "makespan", makespan * 1e3, "ms");
+	bench_report("skew", "makespan_round_robin_bound", round_robin * 1e3, "ms");
+	bench_report("skew", "makespan_ideal", total / threads_num * 1e3, "ms");
+	bench_report("skew", "latency_p50", bench_percentile(latency, tasks_num, 50) * 1e3, "ms");
+	bench_report("skew", "latency_p99", bench_percentile(latency, tasks_num, 99) * 1e3, "ms");
+	bench_report("skew", "latency_max", bench_percentile(latency, tasks_num, 100) * 1e3, "ms");
+
+	free(per_worker);
+	free(latency);
+	free(jobs);
+	return 0;
+}
@@ -0,0 +1,147 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "threadpool.h"
+#include "linesort.h"
+#include "bench.h"
+
+/*
+ * sort_lines engines head to head on the same random lines:
+ * qsort per chunk plus merge tree against sample sort, qsort against
+ * the prefix kernel inside sample sort, and both engines with the prefix kernel.
+ * Then both engines with the prefix kernel on lines that are mostly the same:
+ * half of them one line, the rest a few dozen others.
+ *
+ * usage: bench_sort [threads] [lines] [rounds]
+ */
+
+static char *text;
+
+/*
+ * Random lines in one buffer, the way lineio hands them out
+ */
+static p_line make_lines(int lines_num)
+{
+	p_line lines = malloc(lines_num * sizeof(t_line));
+	text = malloc((size_t)lines_num * 49);
+	if (lines == NULL || text == NULL)
+		return NULL;
+
+	unsigned int seed = 12345;
+	size_t offset = 0;
+	for (int i = 0; i < lines_num; i++) {
+		int len = 8 + (seed >> 16) % 40;
+		lines[i].offset = offset;
+		lines[i].length = len + 1;
+		for (int j = 0; j < len; j++) {
+			seed = seed * 1103515245 + 12345;
+			text[offset++] = 'a' + (seed >> 16) % 26;
+		}
+		text[offset++] = '\n';
+	}
+	return lines;
+}
+
+/*
+ * Views of the first few lines over and over, the text is shared
+ */
+static p_line make_duplicates(p_line lines, int lines_num)
+{
+	p_line duplicates = malloc(lines_num * sizeof(t_line));
+	if (duplicates == NULL)
+		return NULL;
+
+	unsigned int seed = 54321;
+	for (int i = 0; i < lines_num; i++) {
+		seed = seed * 1103515245 + 12345;
+		int which = (seed >> 16) % 2 == 0 ? 0 : 1 + (seed >> 17) % 50;
+		duplicates[i] = lines[which % lines_num];
+	}
+	return duplicates;
+}
+
+static int same(p_line a, p_line b)
+{
+	return a->length == b->length && memcmp(text + a->offset, text + b->offset, a->length) == 0;
+}
+
+static double run(threadpool tp, p_line lines, p_line work, int lines_num, int rounds, int engine)
+{
+	double best = 0;
+	for (int round = 0; round < rounds; round++) {
+		memcpy(work, lines, lines_num * sizeof(t_line));
+		double start = bench_now();
+		sort_lines(tp, text, work, lines_num, engine);
+		double elapsed = bench_now() - start;
+		if (round == 0 || elapsed < best)
+			best = elapsed;
+	}
+	return best;
+}
+
+int main(int argc, char **argv)
+{
+	int threads_num = bench_arg(argc, argv, 1, 4);
+	int lines_num = bench_arg(argc, argv, 2, 1000000);
+	int rounds = bench_arg(argc, argv, 3, 3);
+
+	p_line lines = make_lines(lines_num);
+	p_line merged = malloc(lines_num * sizeof(t_line));
+	p_line sampled = malloc(lines_num * sizeof(t_line));
+	p_line prefixed = malloc(lines_num * sizeof(t_line));
+	p_line merged_prefixed = malloc(lines_num * sizeof(t_line));
+	if (lines == NULL || merged == NULL || sampled == NULL || prefixed == NULL || merged_prefixed == NULL) {
+		fprintf(stderr, "malloc: NULL\n");
+		return 1;
+	}
+
+	threadpool tp = pool_create(threads_num);
+	double merge = run(tp, lines, merged, lines_num, rounds, SORT_MERGE);
+	double sample = run(tp, lines, sampled, lines_num, rounds, SORT_SAMPLE);
+	double prefix = run(tp, lines, prefixed, lines_num, rounds, SORT_SAMPLE | SORT_PREFIX);
+	double merge_prefix = run(tp, lines, merged_prefixed, lines_num, rounds, SORT_MERGE | SORT_PREFIX);
+
+	for (int i = 0; i < lines_num; i++)
+		if (!same(&merged[i], &sampled[i]) || !same(&merged[i], &prefixed[i]) ||
+				!same(&merged[i], &merged_prefixed[i])) {
+			fprintf(stderr, "sort: engines disagree at line %d\n", i);
+			return 1;
+		}
+
+	// merged and sampled are reused for them
+	p_line duplicates = make_duplicates(lines, lines_num);
+	if (duplicates == NULL) {
+		fprintf(stderr, "malloc: NULL\n");
+		return 1;
+	}
+	double merge_duplicates = run(tp, duplicates, merged, lines_num, rounds, SORT_MERGE | SORT_PREFIX);
+	double sample_duplicates = run(tp, duplicates, sampled, lines_num, rounds, SORT_SAMPLE | SORT_PREFIX);
+	pool_destroy(tp);
+
+	for (int i = 0; i < lines_num; i++)
+		if (!same(&merged[i], &sampled[i])) {
+			fprintf(stderr, "sort: engines disagree on duplicates at line %d\n", i);
+			return 1;
+		}
+
+	bench_report("sort", "merge_engine", merge * 1e3, "ms");
+	bench_report("sort", "sample_engine", sample * 1e3, "ms");
+	bench_report("sort", "sample_speedup", merge / sample, "x");
+	bench_report("sort", "sample_prefix_engine", prefix * 1e3, "ms");
+	bench_report("sort", "prefix_speedup", sample / prefix, "x");
+	bench_report("sort", "merge_prefix_engine", merge_prefix * 1e3, "ms");
+	bench_report("sort", "sample_prefix_speedup", merge_prefix / prefix, "x");
+	bench_report("sort", "duplicates_merge_engine", merge_duplicates * 1e3, "ms");
+	bench_report("sort", "duplicates_sample_engine", sample_duplicates * 1e3, "ms");
+	bench_report("sort", "duplicates_sample_speedup", merge_duplicates / sample_duplicates, "x");
+
+	free(duplicates);
+	free(merged_prefixed);
+	free(prefixed);
+	free(sampled);
+	free(merged);
+	free(lines);
+	free(text);
+	return 0;
+}
@@ -0,0 +1,102 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "platform.h"
+#include "threadpool.h"
+#include "bench.h"
+
+/*
+ * Timer overhead with a crowded wheel: pending timers are added
+ * over a minute ahead, then cancelled in random order, per operation.
+ * Then fired timers, all due within window_ms, and how late their tasks start.
+ *
+ * usage: bench_timers [threads] [pending] [fired] [window_ms] [tick_us]
+ */
+
+typedef struct __fired {
+	long long *due;
+	double *late;
+	atomic_int left;
+	os_event done;
+} t_fired;
+
+static t_fired fired;
+
+static void noop(void *args)
+{
+	(void)args;
+}
+
+static void record(void *args)
+{
+	long i = (long)args;
+	fired.late[i] = (double)(pool_now_ns() - fired.due[i]);
+	if (atomic_fetch_sub(&fired.left, 1) == 1)
+		os_event_set(&fired.done);
+}
+
+static void shuffle(pool_timer *timers, int n)
+{
+	for (int i = n - 1; i > 0; i--) {
+		int j = rand() % (i + 1);
+		pool_timer t = timers[i];
+		timers[i] = timers[j];
+		timers[j] = t;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	pool_options options;
+	pool_options_init(&options, bench_arg(argc, argv, 1, 4));
+	int pending = bench_arg(argc, argv, 2, 500000);
+	int fired_num = bench_arg(argc, argv, 3, 10000);
+	long long window = bench_arg(argc, argv, 4, 200) * 1000000LL;
+	options.timer_tick_us = bench_arg(argc, argv, 5, 1000);
+
+	pool_timer *timers = malloc(pending * sizeof(pool_timer));
+	fired.due = malloc(fired_num * sizeof(long long));
+	fired.late = malloc(fired_num * sizeof(double));
+	if (timers == NULL || fired.due == NULL || fired.late == NULL) {
+		fprintf(stderr, "malloc: NULL\n");
+		return 1;
+	}
+
+	threadpool tp = pool_create_ex(&options);
+	srand(1);
+
+	long long base = pool_now_ns() + 60000000000LL;
+	double start = bench_now();
+	for (int i = 0; i < pending; i++)
+		timers[i] = pool_add_task_at(tp, base + (rand() % 60000) * 1000000LL, noop, NULL);
+	bench_report("timers", "add", (bench_now() - start) * 1e9 / pending, "ns");
+
+	shuffle(timers, pending);
+	start = bench_now();
+	for (int i = 0; i < pending; i++)
+		pool_cancel_timer(tp, timers[i]);
+	bench_report("timers", "cancel", (bench_now() - start) * 1e9 / pending, "ns");
+
+	// the pending ones are back, the fired ones have company
+	for (int i = 0; i < pending; i++)
+		timers[i] = pool_add_task_at(tp, base + (rand() % 60000) * 1000000LL, noop, NULL);
+
+	atomic_init(&fired.left, fired_num);
+	os_event_init(&fired.done);
+	long long now = pool_now_ns();
+	for (long i = 0; i < fired_num; i++) {
+		fired.due[i] = now + 1000000 + (long long)((double)rand() / RAND_MAX * window);
+		pool_add_task_at(tp, fired.due[i], record, (void *)i);
+	}
+	os_event_wait(&fired.done);
+
+	bench_report("timers", "late_p50", bench_percentile(fired.late, fired_num, 50) / 1e3, "us");
+	bench_report("timers", "late_p99", bench_percentile(fired.late, fired_num, 99) / 1e3, "us");
+
+	pool_destroy(tp);
+	os_event_destroy(&fired.done);
+	free(timers);
+	free(fired.due);
+	free(fired.late);
+	return 0;
+}
@@ -0,0 +1,245 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "platform.h"
+#include "wheel.h"
+#include "threadpool.h"
+#include "bench.h"
+
+/*
+ * Checks the timers rather than timing them. The wheel alone first, on
+ * made up ticks: deadlines on and around every level boundary and random
+ * ones, periodic items, cancels before and after firing, advanced in
+ * random steps. An item has to fire in the step that reaches its deadline,
+ * never before, and a cancelled one never. Then the pool's timers on the clock:
+ * a deadline past the first level, a cancelled one and a periodic one.
+ * Exits with 1 on the first thing that is wrong, ctest runs it as the test wheel.
+ *
+ * usage: bench_wheel [items] [tick_us]
+ */
+
+typedef struct __item {
+	long long expires;
+	long long period;
+	long long id;
+	int fired;
+	int cancelled;
+} t_item, *p_item;
+
+// the step being advanced, an item is due in (from, to]
+typedef struct __step {
+	long long from;
+	long long to;
+	long errors;
+} t_step, *p_step;
+
+typedef struct __fired {
+	long long due;
+	long long at;
+	long long period;
+	long long periodic_start;
+	// firing times of the periodic timer
+	long long periodic[10];
+	atomic_int periodic_num;
+	atomic_int cancelled_fired;
+	atomic_int left;
+	os_event done;
+} t_fired;
+
+static t_fired fired;
+
+static void expired(void *data, void *ctx)
+{
+	p_item item = (p_item)data;
+	p_step step = (p_step)ctx;
+
+	if (item->cancelled || (item->period == 0 && item->fired) ||
+			item->expires <= step->from || item->expires > step->to) {
+		if (step->errors++ == 0)
+			fprintf(stderr, "wheel: item due at %lld fired in (%lld, %lld]%s\n", item->expires,
+					step->from, step->to, item->cancelled ? " after its cancel" : "");
+	}
+	item->fired++;
+	item->expires += item->period;
+}
+
+static void on_time(void *args)
+{
+	(void)args;
+	fired.at = pool_now_ns();
+	if (atomic_fetch_sub(&fired.left, 1) == 1)
+		os_event_set(&fired.done);
+}
+
+static void never(void *args)
+{
+	(void)args;
+	atomic_fetch_add(&fired.cancelled_fired, 1);
+}
+
+static void every(void *args)
+{
+	(void)args;
+	int n = atomic_fetch_add(&fired.periodic_num, 1);
+	if (n >= 10)
+		return;
+	fired.periodic[n] = pool_now_ns();
+	if (n + 1 == 10 && atomic_fetch_sub(&fired.left, 1) == 1)
+		os_event_set(&fired.done);
+}
+
+static long long random_below(long long n)
+{
+	long long r = ((long long)rand() << 31) ^ ((long long)rand() << 15) ^ rand();
+	return (r & 0x7fffffffffffffffLL) % n;
+}
+
+/*
+ * Returns:
+ *	errors found
+ */
+static long check_wheel(int items_num)
+{
+	// on, just before and just after where level 1, 2 and 3 start, and past the span
+	static const long long edges[] = { 1, 255, 256, 257, 511, 512, 65535, 65536, 65537,
+		(1LL << 24) - 1, 1LL << 24, (1LL << 24) + 1, (1LL << 32) + 5 };
+	int edges_num = sizeof(edges) / sizeof(edges[0]);
+
+	p_item items = calloc(items_num, sizeof(t_item));
+	wheel timers = wheel_create(0);
+	if (items == NULL || timers == NULL) {
+		fprintf(stderr, "malloc: NULL\n");
+		exit(1);
+	}
+
+	t_step step = { 0, 0, 0 };
+	int edge = 0;
+	long long last = 0;
+	for (int i = 0; i < items_num; i++) {
+		p_item item = &items[i];
+		item->expires = i < edges_num ? edges[i] : 1 + random_below(1LL << 26);
+		// some periodic ones, with periods crossing a level boundary every time
+		if (i >= edges_num && i % 16 == 0)
+			item->period = i % 128 == 0 ? 256 + random_below(1000) : 64 + random_below(100000);
+		item->id = wheel_add(timers, item->expires, item->period, item);
+		if (item->id <= 0) {
+			fprintf(stderr, "wheel: wheel_add failed\n");
+			exit(1);
+		}
+		if (item->period == 0 && item->expires > last)
+			last = item->expires;
+	}
+
+	while (step.to < last) {
+		step.from = step.to;
+		// small steps mostly, then and now a long jump
+		step.to += rand() % 64 == 0 ? random_below(1LL << 22) : 1 + random_below(4096);
+		// a step ends right on every edge, so one tick late shows
+		if (edge < edges_num && step.to >= edges[edge])
+			step.to = edges[edge++];
+		wheel_advance(timers, step.to, expired, &step);
+
+		// the periodic ones have gone round often enough by then
+		if (step.from < 1LL << 22 && step.to >= 1LL << 22)
+			for (int i = 0; i < items_num; i++)
+				if (items[i].period > 0 && !items[i].cancelled) {
+					if (wheel_cancel(timers, items[i].id, NULL) != 0 && step.errors++ == 0)
+						fprintf(stderr, "wheel: cancel of a periodic item failed\n");
+					items[i].cancelled = 1;
+				}
+
+		// a few pending items cancelled, a few fired ones have to refuse
+		for (int j = 0; j < 4; j++) {
+			p_item item = &items[random_below(items_num)];
+			if (item->cancelled)
+				continue;
+			int pending = item->period > 0 || !item->fired;
+			int ret = wheel_cancel(timers, item->id, NULL);
+			if (ret != (pending ? 0 : -1) && step.errors++ == 0)
+				fprintf(stderr, "wheel: cancel of a %s item returned %d\n", pending ? "pending" : "fired", ret);
+			item->cancelled = pending;
+		}
+	}
+
+	for (int i = 0; i < items_num; i++) {
+		p_item item = &items[i];
+		if (item->period == 0 && !item->cancelled && !item->fired && step.errors++ == 0)
+			fprintf(stderr, "wheel: item due at %lld never fired\n", item->expires);
+	}
+	if (wheel_count(timers) != 0 && step.errors++ == 0)
+		fprintf(stderr, "wheel: %d items left\n", wheel_count(timers));
+
+	wheel_destroy(timers);
+	free(items);
+	return step.errors;
+}
+
+/*
+ * Returns:
+ *	errors found
+ */
+static long check_pool(int tick_us)
+{
+	pool_options options;
+	pool_options_init(&options, 2);
+	options.timer_tick_us = tick_us;
+	threadpool tp = pool_create_ex(&options);
+
+	long long tick = tick_us * 1000LL;
+	atomic_init(&fired.periodic_num, 0);
+	atomic_init(&fired.cancelled_fired, 0);
+	atomic_init(&fired.left, 2);
+	os_event_init(&fired.done);
+
+	// a level 1 deadline, and an earlier one cancelled at once
+	long long now = pool_now_ns();
+	fired.due = now + 400 * tick;
+	pool_add_task_at(tp, fired.due, on_time, NULL);
+	long errors = pool_cancel_timer(tp, pool_add_task_at(tp, now + 300 * tick, never, NULL)) != 0;
+
+	fired.period = 50 * tick;
+	fired.periodic_start = pool_now_ns();
+	pool_timer periodic = pool_add_task_every(tp, fired.period, every, NULL);
+
+	// the deadline goes after the cancelled one, so that one had its chance
+	os_event_wait(&fired.done);
+	errors += pool_cancel_timer(tp, periodic) != 0;
+	pool_wait(tp);
+	pool_destroy(tp);
+	os_event_destroy(&fired.done);
+
+	if (errors > 0)
+		fprintf(stderr, "pool: pool_cancel_timer failed\n");
+	if (fired.at < fired.due) {
+		fprintf(stderr, "pool: fired %lld ns early\n", fired.due - fired.at);
+		errors++;
+	}
+	if (atomic_load(&fired.cancelled_fired) > 0) {
+		fprintf(stderr, "pool: a cancelled timer fired\n");
+		errors++;
+	}
+	for (int k = 0; k < 10; k++)
+		if (fired.periodic[k] < fired.periodic_start + (k + 1) * fired.period) {
+			fprintf(stderr, "pool: periodic firing %d early\n", k);
+			errors++;
+		}
+
+	bench_report("wheel", "pool_late", (fired.at - fired.due) / 1e3, "us");
+	return errors;
+}
+
+int main(int argc, char **argv)
+{
+	int items_num = bench_arg(argc, argv, 1, 100000);
+	int tick_us = bench_arg(argc, argv, 2, 100);
+
+	srand(1);
+	long errors = check_wheel(items_num);
+	bench_report("wheel", "wheel_errors", errors, "");
+	if (errors > 0)
+		return 1;
+
+	errors = check_pool(tick_us);
+	bench_report("wheel", "pool_errors", errors, "");
+	return errors > 0;
+}
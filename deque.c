@@ -0,0 +1,182 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "platform.h"
+#include "deque.h"
+
+/*
+ * Follows "Correct and Efficient Work-Stealing for Weak Memory Models"
+ * (Le, Pop, Cohen, Zappa Nardelli), C11 version.
+ */
+
+#define DQ_INITIAL_SIZE 64
+
+typedef struct __array {
+	long size;
+	struct __array *retired; // previous (smaller) array
+	_Atomic(void *) buffer[];
+} t_array, *p_array;
+
+typedef struct __deque {
+	atomic_long top;
+	char pad_top[CACHE_LINE - sizeof(atomic_long)];
+	atomic_long bottom;
+	char pad_bottom[CACHE_LINE - sizeof(atomic_long)];
+	_Atomic(p_array) array;
+} t_deque, *p_deque;
+
+
+	/*	Prototypes	*/
+
+p_deque dq_create(void);
+void dq_destroy(p_deque deque);
+int dq_push(p_deque deque, void *data);
+void* dq_pop(p_deque deque);
+void* dq_steal(p_deque deque);
+int dq_length(p_deque deque);
+
+static p_array array_create(long size);
+static p_array array_grow(p_array array, long bottom, long top);
+
+
+	/*	Deque functions	*/
+
+p_deque dq_create(void)
+{
+	p_deque deque = malloc(sizeof(t_deque));
+	if (deque == NULL)
+		return NULL;
+
+	p_array array = array_create(DQ_INITIAL_SIZE);
+	if (array == NULL) {
+		free(deque);
+		return NULL;
+	}
+
+	atomic_init(&deque->top, 0);
+	atomic_init(&deque->bottom, 0);
+	atomic_init(&deque->array, array);
+	return deque;
+}
+
+void dq_destroy(p_deque deque)
+{
+	if (deque == NULL)
+		return;
+
+	p_array array = atomic_load(&deque->array);
+	while (array != NULL) {
+		p_array retired = array->retired;
+		free(array);
+		array = retired;
+	}
+	free(deque);
+}
+
+int dq_length(p_deque deque)
+{
+	if (deque == NULL)
+		return -1;
+
+	long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+	long top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+	return bottom > top ? (int)(bottom - top) : 0;
+}
+
+int dq_push(p_deque deque, void *data)
+{
+	long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+	long top = atomic_load_explicit(&deque->top, memory_order_acquire);
+	p_array array = atomic_load_explicit(&deque->array, memory_order_relaxed);
+
+	if (bottom - top > array->size - 1) {
+		array = array_grow(array, bottom, top);
+		if (array == NULL)
+			return -1;
+		atomic_store_explicit(&deque->array, array, memory_order_release);
+	}
+
+	atomic_store_explicit(&array->buffer[bottom & (array->size - 1)], data, memory_order_relaxed);
+	// a release store rather than the paper's fence + relaxed store,
+	// same code on x86 and ThreadSanitizer understands it
+	atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_release);
+	return 0;
+}
+
+void* dq_pop(p_deque deque)
+{
+	long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+	p_array array = atomic_load_explicit(&deque->array, memory_order_relaxed);
+	atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed);
+	atomic_thread_fence(memory_order_seq_cst);
+	long top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+	void *data = NULL;
+	if (top <= bottom) {
+		data = atomic_load_explicit(&array->buffer[bottom & (array->size - 1)], memory_order_relaxed);
+		if (top == bottom) {
+			// the last one, thieves may be after it as well
+			if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1,
+					memory_order_seq_cst, memory_order_relaxed))
+				data = NULL;
+			atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+		}
+	}
+	else {
+		// was empty, restore
+		atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+	}
+	return data;
+}
+
+void* dq_steal(p_deque deque)
+{
+	long top = atomic_load_explicit(&deque->top, memory_order_acquire);
+	atomic_thread_fence(memory_order_seq_cst);
+	long bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+
+	if (top >= bottom)
+		return NULL;
+
+	p_array array = atomic_load_explicit(&deque->array, memory_order_acquire);
+	void *data = atomic_load_explicit(&array->buffer[top & (array->size - 1)], memory_order_relaxed);
+	if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1,
+			memory_order_seq_cst, memory_order_relaxed))
+		return NULL;
+	return data;
+}
+
+		/*	Array functions	*/
+
+/*
+ * size must be a power of two
+ */
+static p_array array_create(long size)
+{
+	p_array array = malloc(sizeof(t_array) + size * sizeof(void *));
+	if (array == NULL) {
+		fprintf(stderr, "array_create: malloc\n");
+		return NULL;
+	}
+	array->size = size;
+	array->retired = NULL;
+	return array;
+}
+
+/*
+ * Thieves may still be reading the old array,
+ * so it is kept until dq_destroy
+ */
+static p_array array_grow(p_array array, long bottom, long top)
+{
+	p_array grown = array_create(array->size * 2);
+	if (grown == NULL)
+		return NULL;
+
+	for (long i = top; i < bottom; i++) {
+		void *data = atomic_load_explicit(&array->buffer[i & (array->size - 1)], memory_order_relaxed);
+		atomic_store_explicit(&grown->buffer[i & (grown->size - 1)], data, memory_order_relaxed);
+	}
+	grown->retired = array;
+	return grown;
+}
@@ -0,0 +1,48 @@
+#ifndef H_DEQUE
+#define H_DEQUE
+/*
+ * Lock-free work-stealing deque (Chase-Lev).
+ * One owner thread pushes and pops at the bottom,
+ * any other thread may steal from the top.
+ */
+typedef struct __deque* deque;
+
+/*
+ * Returns:
+ *	NULL on error
+ */
+deque dq_create(void);
+
+/*
+ * Nobody may touch the deque anymore
+ */
+void dq_destroy(deque);
+
+/*
+ * Owner only
+ * Returns:
+ *	-1 on error
+ * 	0 otherwise
+ */
+int dq_push(deque, void*);
+
+/*
+ * Owner only, LIFO
+ * Returns:
+ *	NULL if empty
+ */
+void* dq_pop(deque);
+
+/*
+ * Any thread, FIFO
+ * Returns:
+ *	NULL if empty or another thread won the race for the item
+ */
+void* dq_steal(deque);
+
+/*
+ * Approximate when called concurrently
+ */
+int dq_length(deque);
+
+#endif
@@ -0,0 +1,507 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "threadpool.h"
+#include "lineio.h"
+#include "linesort.h"
+#include "extsort.h"
+
+// the budget over the text of a chunk: two chunks are held at once,
+// the index and the sort's scratch take several times the text of one
+#define CHUNK_SHARE 8
+#define CHUNK_MIN (64 << 10)
+
+// runs merged at once: MERGE_WAYS runs of a level make one of the next,
+// so every byte is written once per level, and few files are open
+#define MERGE_WAYS 64
+// 64^8 chunks, the top level just merges into itself
+#define MERGE_LEVELS 8
+// the budget over the read buffers of the runs being merged
+#define MERGE_SHARE 2
+#define MERGE_BUFFER_MIN (64 << 10)
+// merged lines gathered for one fwrite
+#define MERGE_OUTPUT (1 << 20)
+
+// a piece of the input, the next one is read on the pool while this one is sorted
+typedef struct __chunk {
+	FILE *handle;
+	char *buffer;
+	// one byte more than is read, for a newline the last line may lack
+	size_t capacity;
+	// bytes read, the whole lines among them are input.size
+	size_t size;
+	t_input input;
+	// the unfinished line at the end of the previous chunk, goes first
+	const char *carry;
+	size_t carry_size;
+	// NULL when it was read inline
+	future read;
+	int eof;
+	int failed;
+} t_chunk, *p_chunk;
+
+// a sorted run read back one line at a time
+typedef struct __run {
+	FILE *file;
+	char *buffer;
+	size_t capacity;
+	// the line at the head is [start, start + length), read up to end.
+	// length is 0 once the run is over
+	size_t start;
+	size_t length;
+	size_t end;
+} t_run, *p_run;
+
+// spilled runs, a level's are merged from MERGE_WAYS of the level below, oldest first
+typedef struct __runs {
+	FILE *files[MERGE_LEVELS][MERGE_WAYS];
+	int num[MERGE_LEVELS];
+	int total;
+} t_runs, *p_runs;
+
+
+	/*	Prototypes	*/
+
+int sort_file(threadpool tp, const char *path, FILE *output, size_t budget, int engine);
+
+static int sort_chunks(threadpool tp, p_chunk chunks, FILE *output, p_runs runs, size_t budget, int engine);
+static int chunk_spill(threadpool tp, p_chunk chunk, p_runs runs, size_t budget);
+
+static void chunk_start(threadpool tp, p_chunk chunk);
+static void chunk_wait(p_chunk chunk);
+static void* chunk_read(void *c);
+static int chunk_grow(p_chunk chunk, size_t capacity);
+
+static int runs_add(p_runs runs, int level, FILE *file, size_t budget);
+static int runs_finish(p_runs runs, FILE *output, size_t budget);
+static int runs_merge(FILE **files, int files_num, FILE *output, size_t budget);
+static int runs_tree(p_run runs, int runs_num, int *tree, FILE *output);
+static int run_next(p_run run);
+static int run_less(p_run runs, int a, int b);
+
+
+int sort_file(threadpool tp, const char *path, FILE *output, size_t budget, int engine)
+{
+	int from_stdin = strcmp(path, "-") == 0;
+	FILE *handle = from_stdin ? stdin : fopen(path, "rb");
+	if (handle == NULL) {
+		fprintf(stderr, "sort_file: Couldn't open a file\n");
+		return -1;
+	}
+
+	size_t chunk_size = budget / CHUNK_SHARE > CHUNK_MIN ? budget / CHUNK_SHARE : CHUNK_MIN;
+	t_chunk chunks[2];
+	memset(chunks, 0, sizeof(chunks));
+	t_runs runs;
+	memset(&runs, 0, sizeof(runs));
+
+	int ret = 0;
+	for (int i = 0; i < 2; i++) {
+		chunks[i].handle = handle;
+		chunks[i].capacity = chunk_size + 1;
+		chunks[i].buffer = malloc(chunks[i].capacity);
+		if (chunks[i].buffer == NULL)
+			ret = -1;
+	}
+	if (ret != 0)
+		fprintf(stderr, "sort_file: malloc\n");
+
+	if (ret == 0)
+		ret = sort_chunks(tp, chunks, output, &runs, budget, engine);
+	if (ret == 0 && runs.total > 0)
+		ret = runs_finish(&runs, output, budget);
+
+	for (int i = 0; i < 2; i++) {
+		// a read may still be going on after an error
+		chunk_wait(&chunks[i]);
+		free(chunks[i].input.lines);
+		free(chunks[i].buffer);
+	}
+	for (int l = 0; l < MERGE_LEVELS; l++)
+		for (int i = 0; i < runs.num[l]; i++)
+			fclose(runs.files[l][i]);
+	if (!from_stdin)
+		fclose(handle);
+	return ret;
+}
+
+/*
+ * Chunks are read one ahead, so the pool sorts one while the next comes in.
+ * A lone chunk goes straight to output, the others are spilled as runs
+ * Returns:
+ *	-1 on error
+ * 	0 otherwise
+ */
+static int sort_chunks(threadpool tp, p_chunk chunks, FILE *output, p_runs runs, size_t budget, int engine)
+{
+	int current = 0;
+	chunk_start(tp, &chunks[current]);
+	for (;;) {
+		p_chunk chunk = &chunks[current];
+		p_chunk next = &chunks[current ^ 1];
+
+		chunk_wait(chunk);
+		if (chunk->failed)
+			return -1;
+		if (input_index(&chunk->input, tp) != 0)
+			return -1;
+
+		if (!chunk->eof) {
+			next->carry = chunk->buffer + chunk->input.size;
+			next->carry_size = chunk->size - chunk->input.size;
+			chunk_start(tp, next);
+		}
+
+		int ret = sort_lines(tp, chunk->input.base, chunk->input.lines, chunk->input.lines_num, engine);
+		if (ret == 0 && chunk->eof && runs->total == 0)
+			ret = output_lines(tp, output, chunk->input.base, chunk->input.lines, chunk->input.lines_num);
+		else if (ret == 0)
+			ret = chunk_spill(tp, chunk, runs, budget);
+
+		free(chunk->input.lines);
+		chunk->input.lines = NULL;
+		if (ret != 0 || chunk->eof)
+			return ret;
+		current ^= 1;
+	}
+}
+
+/*
+ * Writes the sorted chunk to a temporary file, a run of level 0
+ * Returns:
+ *	-1 on error
+ * 	0 otherwise
+ */
+static int chunk_spill(threadpool tp, p_chunk chunk, p_runs runs, size_t budget)
+{
+	FILE *run = tmpfile();
+	if (run == NULL) {
+		fprintf(stderr, "chunk_spill: tmpfile\n");
+		return -1;
+	}
+	if (output_lines(tp, run, chunk->input.base, chunk->input.lines, chunk->input.lines_num) != 0) {
+		fclose(run);
+		return -1;
+	}
+	return runs_add(runs, 0, run, budget);
+}
+
+	/*	Chunk functions	*/
+
+/*
+ * Hands the read to the pool, or reads right here without one
+ */
+static void chunk_start(threadpool tp, p_chunk chunk)
+{
+	chunk->read = tp != NULL ? pool_submit(tp, chunk_read, (void *)chunk) : NULL;
+	if (chunk->read == NULL)
+		chunk_read(chunk);
+}
+
+static void chunk_wait(p_chunk chunk)
+{
+	if (chunk->read == NULL)
+		return;
+
+	future_wait(chunk->read);
+	future_release(chunk->read);
+	chunk->read = NULL;
+}
+
+/*
+ * The carry and then as much as fits. Whole lines are input.size bytes,
+ * if there isn't a single newline the buffer grows until there is one.
+ * Failures are left in failed
+ */
+static void* chunk_read(void *c)
+{
+	p_chunk chunk = (p_chunk)c;
+
+	if (chunk->carry_size + 1 >= chunk->capacity && chunk_grow(chunk, 2 * (chunk->carry_size + 1)) != 0)
+		return chunk;
+	// the first chunk has none
+	if (chunk->carry_size > 0)
+		memcpy(chunk->buffer, chunk->carry, chunk->carry_size);
+
+	size_t size = chunk->carry_size;
+	size_t lines_end = 0;
+	for (;;) {
+		size_t wanted = chunk->capacity - 1 - size;
+		size_t got = fread(chunk->buffer + size, 1, wanted, chunk->handle);
+		// the carry has no newline, nor had the bytes before these
+		for (size_t i = size + got; i > size; i--)
+			if (chunk->buffer[i - 1] == '\n') {
+				lines_end = i;
+				break;
+			}
+		size += got;
+
+		if (got < wanted) {
+			chunk->eof = 1;
+			break;
+		}
+		if (lines_end > 0)
+			break;
+		if (chunk_grow(chunk, chunk->capacity * 2) != 0)
+			return chunk;
+	}
+	if (ferror(chunk->handle)) {
+		fprintf(stderr, "chunk_read: fread\n");
+		chunk->failed = 1;
+		return chunk;
+	}
+
+	// runs are split on newlines, so the last line gets one
+	if (chunk->eof && lines_end < size) {
+		chunk->buffer[size++] = '\n';
+		lines_end = size;
+	}
+	chunk->size = size;
+	chunk->input.base = chunk->buffer;
+	chunk->input.size = lines_end;
+	return chunk;
+}
+
+static int chunk_grow(p_chunk chunk, size_t capacity)
+{
+	char *grown = realloc(chunk->buffer, capacity);
+	if (grown == NULL) {
+		fprintf(stderr, "chunk_grow: malloc\n");
+		chunk->failed = 1;
+		return -1;
+	}
+	chunk->buffer = grown;
+	chunk->capacity = capacity;
+	return 0;
+}
+
+	/*	Merge functions	*/
+
+/*
+ * A full level is merged into one run of the next, which may fill that one in turn.
+ * Only runs of the same level meet, each about MERGE_WAYS times the one below
+ * Returns:
+ *	-1 on error
+ * 	0 otherwise
+ */
+static int runs_add(p_runs runs, int level, FILE *file, size_t budget)
+{
+	runs->files[level][runs->num[level]++] = file;
+	runs->total++;
+	if (runs->num[level] < MERGE_WAYS)
+		return 0;
+
+	FILE *merged = tmpfile();
+	if (merged == NULL) {
+		fprintf(stderr, "runs_add: tmpfile\n");
+		return -1;
+	}
+	int ret = runs_merge(runs->files[level], MERGE_WAYS, merged, budget);
+	for (int i = 0; i < MERGE_WAYS; i++)
+		fclose(runs->files[level][i]);
+	runs->num[level] = 0;
+	runs->total -= MERGE_WAYS;
+	if (ret != 0) {
+		fclose(merged);
+		return -1;
+	}
+	return runs_add(runs, level + 1 < MERGE_LEVELS ? level + 1 : level, merged, budget);
+}
+
+/*
+ * What is left of every level in one merge, the oldest runs first
+ * Returns:
+ *	-1 on error
+ * 	0 otherwise
+ */
+static int runs_finish(p_runs runs, FILE *output, size_t budget)
+{
+	FILE *files[MERGE_LEVELS * MERGE_WAYS];
+	int files_num = 0;
+	for (int l = MERGE_LEVELS - 1; l >= 0; l--)
+		for (int i = 0; i < runs->num[l]; i++)
+			files[files_num++] = runs->files[l][i];
+	return runs_merge(files, files_num, output, budget);
+}
+
+/*
+ * Streams the sorted files into output through a loser tree,
+ * every file read in large blocks of its own
+ * Returns:
+ *	-1 on error
+ * 	0 otherwise
+ */
+static int runs_merge(FILE **files, int files_num, FILE *output, size_t budget)
+{
+	size_t capacity = budget / MERGE_SHARE / files_num;
+	if (capacity < MERGE_BUFFER_MIN)
+		capacity = MERGE_BUFFER_MIN;
+
+	p_run runs = calloc(files_num, sizeof(t_run));
+	int *tree = malloc(files_num * sizeof(int));
+	int ret = runs != NULL && tree != NULL ? 0 : -1;
+	for (int i = 0; ret == 0 && i < files_num; i++) {
+		rewind(files[i]);
+		runs[i].file = files[i];
+		runs[i].capacity = capacity;
+		runs[i].buffer = malloc(capacity);
+		if (runs[i].buffer == NULL)
+			ret = -1;
+	}
+	if (ret != 0)
+		fprintf(stderr, "runs_merge: malloc\n");
+
+	for (int i = 0; ret == 0 && i < files_num; i++)
+		ret = run_next(&runs[i]);
+	if (ret == 0)
+		ret = runs_tree(runs, files_num, tree, output);
+
+	for (int i = 0; runs != NULL && i < files_num; i++)
+		free(runs[i].buffer);
+	free(runs);
+	free(tree);
+	return ret;
+}
+
+/*
+ * Leaves are runs_num + i, tree[1..runs_num) keeps the loser of each match
+ * and tree[0] the overall winner, so a new head replays only its own path.
+ * Returns:
+ *	-1 on error
+ * 	0 otherwise
+ */
+static int runs_tree(p_run runs, int runs_num, int *tree, FILE *output)
+{
+	if (runs_num < 1)
+		return 0;
+	char *buffer = malloc(MERGE_OUTPUT);
+	if (buffer == NULL) {
+		fprintf(stderr, "runs_tree: malloc\n");
+		return -1;
+	}
+
+	// a match is played once both of its sides got there, the first one waits in it
+	for (int i = 0; i < runs_num; i++)
+		tree[i] = -1;
+	for (int i = 0; i < runs_num; i++) {
+		int winner = i;
+		int node = (i + runs_num) / 2;
+		for (; node > 0 && tree[node] >= 0; node /= 2)
+			if (run_less(runs, tree[node], winner)) {
+				int loser = winner;
+				winner = tree[node];
+				tree[node] = loser;
+			}
+		tree[node] = winner;
+	}
+
+	int ret = 0;
+	size_t used = 0;
+	while (ret == 0 && runs[tree[0]].length > 0) {
+		p_run run = &runs[tree[0]];
+		const char *line = run->buffer + run->start;
+
+		if (used + run->length > MERGE_OUTPUT) {
+			if (fwrite(buffer, 1, used, output) != used)
+				ret = -1;
+			used = 0;
+		}
+		if (run->length > MERGE_OUTPUT) {
+			if (fwrite(line, 1, run->length, output) != run->length)
+				ret = -1;
+		} else {
+			memcpy(buffer + used, line, run->length);
+			used += run->length;
+		}
+		if (ret != 0) {
+			fprintf(stderr, "runs_tree: fwrite\n");
+			break;
+		}
+		if (run_next(run) != 0) {
+			ret = -1;
+			break;
+		}
+
+		int winner = tree[0];
+		for (int node = (winner + runs_num) / 2; node > 0; node /= 2)
+			if (run_less(runs, tree[node], winner)) {
+				int loser = winner;
+				winner = tree[node];
+				tree[node] = loser;
+			}
+		tree[0] = winner;
+	}
+
+	if (ret == 0 && (fwrite(buffer, 1, used, output) != used || fflush(output) != 0)) {
+		fprintf(stderr, "runs_tree: fwrite\n");
+		ret = -1;
+	}
+	free(buffer);
+	return ret;
+}
+
+/*
+ * Moves the head on, refilling the buffer when the next line isn't all in it
+ * Returns:
+ *	-1 on error
+ * 	0 otherwise
+ */
+static int run_next(p_run run)
+{
+	run->start += run->length;
+	run->length = 0;
+	for (;;) {
+		const char *head = run->buffer + run->start;
+		const char *newline = memchr(head, '\n', run->end - run->start);
+		if (newline != NULL) {
+			run->length = newline + 1 - head;
+			return 0;
+		}
+		if (feof(run->file)) {
+			// nothing left, or a tail we didn't write taken as it is
+			run->length = run->end - run->start;
+			return 0;
+		}
+
+		memmove(run->buffer, head, run->end - run->start);
+		run->end -= run->start;
+		run->start = 0;
+		if (run->end == run->capacity) {
+			char *grown = realloc(run->buffer, run->capacity * 2);
+			if (grown == NULL) {
+				fprintf(stderr, "run_next: malloc\n");
+				return -1;
+			}
+			run->buffer = grown;
+			run->capacity *= 2;
+		}
+		run->end += fread(run->buffer + run->end, 1, run->capacity - run->end, run->file);
+		if (ferror(run->file)) {
+			fprintf(stderr, "run_next: fread\n");
+			return -1;
+		}
+	}
+}
+
+/*
+ * The order of sort_lines, a finished run loses to everything.
+ * Equal lines come from the earlier run first
+ */
+static int run_less(p_run runs, int a, int b)
+{
+	p_run first = &runs[a];
+	p_run second = &runs[b];
+	if (first->length == 0)
+		return 0;
+	if (second->length == 0)
+		return 1;
+
+	size_t length = first->length < second->length ? first->length : second->length;
+	int diff = memcmp(first->buffer + first->start, second->buffer + second->start, length);
+	if (diff != 0)
+		return diff < 0;
+	if (first->length != second->length)
+		return first->length < second->length;
+	return a < b;
+}
@@ -0,0 +1,20 @@
+#ifndef H_EXTSORT
+#define H_EXTSORT
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "threadpool.h"
+
+/*
+ * Sorts a file that needn't fit in memory into output, "-" reads stdin.
+ * Chunks of about budget / 8 bytes are sorted with sort_lines and engine,
+ * spilled to temporary files and merged. Input that fits in one chunk never touches disk.
+ * Every line comes out with a newline, even an unterminated last one
+ * Returns:
+ *	-1 on error
+ *  0 otherwise
+ */
+int sort_file(threadpool, const char *path, FILE *output, size_t budget, int engine);
+
+#endif
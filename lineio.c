@@ -0,0 +1,346 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "platform.h"
+#include "threadpool.h"
+#include "lineio.h"
+
+// first read of a stream, doubled whenever it fills up
+#define INPUT_CHUNK (1 << 20)
+// bytes one task scans for newlines
+#define INDEX_CHUNK (1 << 20)
+// lines gathered into one buffer, one write each
+#define OUTPUT_BATCH 16384
+// buffers being filled or waiting to be written, per worker
+#define OUTPUT_WINDOW_PER_THREAD 2
+
+// the input split into chunks, indexed in two passes
+typedef struct __index {
+	p_input input;
+	size_t chunks_num;
+	// newlines in each chunk, then the index of the first line ending in it
+	size_t *firsts;
+} t_index, *p_index;
+
+// a run of lines copied into one buffer on the pool, written out in turn
+typedef struct __batch {
+	const char *base;
+	p_line lines;
+	size_t lines_num;
+	// kept from one batch to the next in the same slot
+	char *buffer;
+	size_t capacity;
+	size_t size;
+	// NULL when it was filled inline
+	future filled;
+	int failed;
+} t_batch, *p_batch;
+
+
+	/*	Prototypes	*/
+
+p_input input_open(threadpool tp, const char *path);
+void input_close(p_input input);
+int input_index(p_input input, threadpool tp);
+int output_lines(threadpool tp, FILE *handle, const char *base, p_line lines, size_t lines_num);
+
+static int input_read(p_input input, FILE *handle);
+
+static void index_count(long begin, long end, void *args);
+static void index_fill(long begin, long end, void *args);
+
+static void batch_start(threadpool tp, p_batch batch, const char *base, p_line lines, size_t lines_num);
+static void* batch_fill(void *b);
+
+
+	/*	Input functions	*/
+
+p_input input_open(threadpool tp, const char *path)
+{
+	p_input input = calloc(1, sizeof(t_input));
+	if (input == NULL)
+		return NULL;
+
+	int from_stdin = strcmp(path, "-") == 0;
+	if (!from_stdin)
+		input->base = os_map_file(path, &input->size);
+
+	if (input->base != NULL)
+		input->mapped = 1;
+	else {
+		// a pipe, an empty file or no mmap: plain buffered reads
+		FILE *handle = from_stdin ? stdin : fopen(path, "rb");
+		if (handle == NULL) {
+			fprintf(stderr, "input_open: Couldn't open a file\n");
+			free(input);
+			return NULL;
+		}
+		int ret = input_read(input, handle);
+		if (!from_stdin)
+			fclose(handle);
+		if (ret != 0) {
+			input_close(input);
+			return NULL;
+		}
+	}
+
+	if (input_index(input, tp) != 0) {
+		input_close(input);
+		return NULL;
+	}
+	return input;
+}
+
+void input_close(p_input input)
+{
+	if (input == NULL)
+		return;
+
+	if (input->mapped)
+		os_unmap_file((void *)input->base, input->size);
+	else
+		free((void *)input->base);
+	free(input->lines);
+	free(input);
+}
+
+/*
+ * The whole stream into one buffer
+ * Returns:
+ *	-1 on error
+ * 	0 otherwise
+ */
+static int input_read(p_input input, FILE *handle)
+{
+	size_t capacity = INPUT_CHUNK;
+	char *buffer = malloc(capacity);
+	size_t size = 0;
+	while (buffer != NULL) {
+		size += fread(buffer + size, 1, capacity - size, handle);
+		if (size < capacity)
+			break;
+
+		capacity *= 2;
+		char *grown = realloc(buffer, capacity);
+		if (grown == NULL)
+			free(buffer);
+		buffer = grown;
+	}
+	if (buffer == NULL) {
+		fprintf(stderr, "input_read: malloc\n");
+		return -1;
+	}
+	if (ferror(handle)) {
+		fprintf(stderr, "input_read: fread\n");
+		free(buffer);
+		return -1;
+	}
+
+	input->base = buffer;
+	input->size = size;
+	return 0;
+}
+
+/*
+ * Chunks are counted in parallel, a prefix sum says where the lines
+ * of each chunk go, and then they are filled in in parallel,
+ * so the index is allocated once and exactly.
+ * Without a pool the same passes run here one chunk after another
+ * Returns:
+ *	-1 on error
+ * 	0 otherwise
+ */
+int input_index(p_input input, threadpool tp)
+{
+	t_index index;
+	index.input = input;
+	index.chunks_num = (input->size + INDEX_CHUNK - 1) / INDEX_CHUNK;
+	index.firsts = malloc((index.chunks_num + 1) * sizeof(size_t));
+	if (index.firsts == NULL) {
+		fprintf(stderr, "input_index: malloc\n");
+		return -1;
+	}
+
+	if (tp == NULL || index.chunks_num < 2 ||
+			pool_parallel_for(tp, 0, index.chunks_num, 1, index_count, (void *)&index) != 0)
+		index_count(0, index.chunks_num, (void *)&index);
+
+	size_t lines_num = 0;
+	for (size_t i = 0; i < index.chunks_num; i++) {
+		size_t newlines = index.firsts[i];
+		index.firsts[i] = lines_num;
+		lines_num += newlines;
+	}
+	index.firsts[index.chunks_num] = lines_num;
+	// the last one may have no newline
+	int unterminated = input->size > 0 && input->base[input->size - 1] != '\n';
+
+	input->lines = malloc((lines_num + unterminated + 1) * sizeof(t_line));
+	if (input->lines == NULL) {
+		fprintf(stderr, "input_index: malloc\n");
+		free(index.firsts);
+		return -1;
+	}
+
+	if (tp == NULL || index.chunks_num < 2 ||
+			pool_parallel_for(tp, 0, index.chunks_num, 1, index_fill, (void *)&index) != 0)
+		index_fill(0, index.chunks_num, (void *)&index);
+
+	if (unterminated) {
+		size_t offset = lines_num > 0 ? input->lines[lines_num - 1].offset + input->lines[lines_num - 1].length : 0;
+		input->lines[lines_num].offset = offset;
+		input->lines[lines_num].length = input->size - offset;
+		lines_num++;
+	}
+	input->lines_num = lines_num;
+
+	free(index.firsts);
+	return 0;
+}
+
+/*
+ * A plain loop the compiler turns into vector compares,
+ * newlines are too dense for a memchr call each
+ */
+static void index_count(long begin, long end, void *args)
+{
+	p_index index = (p_index)args;
+	const char *base = index->input->base;
+	size_t size = index->input->size;
+
+	for (long chunk = begin; chunk < end; chunk++) {
+		size_t first = (size_t)chunk * INDEX_CHUNK;
+		size_t last = first + INDEX_CHUNK < size ? first + INDEX_CHUNK : size;
+		size_t newlines = 0;
+		for (size_t i = first; i < last; i++)
+			newlines += base[i] == '\n';
+		index->firsts[chunk] = newlines;
+	}
+}
+
+/*
+ * A chunk owns the lines ending in it. The first of them may start
+ * in an earlier chunk, so we look back for the newline before it
+ */
+static void index_fill(long begin, long end, void *args)
+{
+	p_index index = (p_index)args;
+	const char *base = index->input->base;
+	size_t size = index->input->size;
+
+	for (long chunk = begin; chunk < end; chunk++) {
+		size_t first = (size_t)chunk * INDEX_CHUNK;
+		size_t last = first + INDEX_CHUNK < size ? first + INDEX_CHUNK : size;
+		// the middle of a long line, the chunk it ends in looks back once
+		if (index->firsts[chunk] == index->firsts[chunk + 1])
+			continue;
+
+		size_t start = first;
+		while (start > 0 && base[start - 1] != '\n')
+			start--;
+
+		p_line line = &index->input->lines[index->firsts[chunk]];
+		const char *at = base + first;
+		while ((at = memchr(at, '\n', base + last - at)) != NULL) {
+			at++;
+			line->offset = start;
+			line->length = at - base - start;
+			start = at - base;
+			line++;
+		}
+	}
+}
+
+	/*	Output functions	*/
+
+/*
+ * A window of batches is filled on the pool while the oldest one is written,
+ * so writes stay in order and the copying hides behind them
+ */
+int output_lines(threadpool tp, FILE *handle, const char *base, p_line lines, size_t lines_num)
+{
+	size_t batches_num = (lines_num + OUTPUT_BATCH - 1) / OUTPUT_BATCH;
+	size_t window = tp != NULL ? (size_t)pool_get_threads_num(tp) * OUTPUT_WINDOW_PER_THREAD : 1;
+	if (window > batches_num)
+		window = batches_num;
+
+	p_batch batches = calloc(window > 0 ? window : 1, sizeof(t_batch));
+	if (batches == NULL) {
+		fprintf(stderr, "output_lines: malloc\n");
+		return -1;
+	}
+
+	size_t started = 0;
+	for (; started < window; started++)
+		batch_start(tp, &batches[started], base, &lines[started * OUTPUT_BATCH], lines_num - started * OUTPUT_BATCH);
+
+	int ret = 0;
+	for (size_t i = 0; i < started; i++) {
+		p_batch batch = &batches[i % window];
+		if (batch->filled != NULL) {
+			future_wait(batch->filled);
+			future_release(batch->filled);
+		}
+
+		if (batch->failed || fwrite(batch->buffer, 1, batch->size, handle) != batch->size) {
+			if (ret == 0)
+				fprintf(stderr, "output_lines: %s\n", batch->failed ? "malloc" : "fwrite");
+			// what is in flight is waited for, nothing new is started
+			ret = -1;
+		}
+		if (ret == 0 && started < batches_num) {
+			batch_start(tp, batch, base, &lines[started * OUTPUT_BATCH], lines_num - started * OUTPUT_BATCH);
+			started++;
+		}
+	}
+	if (ret == 0 && fflush(handle) != 0)
+		ret = -1;
+
+	for (size_t i = 0; i < window; i++)
+		free(batches[i].buffer);
+	free(batches);
+	return ret;
+}
+
+/*
+ * Hands the batch to the pool, or fills it right here without one
+ */
+static void batch_start(threadpool tp, p_batch batch, const char *base, p_line lines, size_t lines_num)
+{
+	batch->base = base;
+	batch->lines = lines;
+	batch->lines_num = lines_num < OUTPUT_BATCH ? lines_num : OUTPUT_BATCH;
+	batch->filled = tp != NULL ? pool_submit(tp, batch_fill, (void *)batch) : NULL;
+	if (batch->filled == NULL)
+		batch_fill(batch);
+}
+
+/*
+ * Gathers the lines of the batch into its buffer, failed is set if it can't grow
+ */
+static void* batch_fill(void *b)
+{
+	p_batch batch = (p_batch)b;
+
+	size_t size = 0;
+	for (size_t i = 0; i < batch->lines_num; i++)
+		size += batch->lines[i].length;
+	if (size > batch->capacity) {
+		free(batch->buffer);
+		batch->buffer = malloc(size);
+		batch->capacity = batch->buffer != NULL ? size : 0;
+		if (batch->buffer == NULL) {
+			batch->failed = 1;
+			return batch;
+		}
+	}
+
+	char *at = batch->buffer;
+	for (size_t i = 0; i < batch->lines_num; i++) {
+		memcpy(at, batch->base + batch->lines[i].offset, batch->lines[i].length);
+		at += batch->lines[i].length;
+	}
+	batch->size = size;
+	return batch;
+}
@@ -0,0 +1,59 @@
+#ifndef H_LINEIO
+#define H_LINEIO
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "threadpool.h"
+
+/*
+ * A line of the input, newline included if it has one.
+ * Not terminated, the bytes are wherever the input keeps them
+ */
+typedef struct __line {
+	size_t offset;
+	size_t length;
+} t_line, *p_line;
+
+/*
+ * All of the input in one piece, mapped or read,
+ * and one contiguous index of its lines
+ */
+typedef struct __input {
+	const char *base;
+	size_t size;
+	p_line lines;
+	size_t lines_num;
+	// munmap'ed rather than free'd
+	int mapped;
+} t_input, *p_input;
+
+/*
+ * Maps the file, or reads it if it can't be mapped.
+ * "-" reads stdin. Lines are indexed on the pool if there is one (tp may be NULL)
+ * Returns:
+ *	NULL on error
+ */
+p_input input_open(threadpool, const char *path);
+
+void input_close(p_input);
+
+/*
+ * Indexes base and size of the input into lines and lines_num,
+ * for buffers that didn't come from input_open (tp may be NULL)
+ * Returns:
+ *	-1 on error
+ *  0 otherwise
+ */
+int input_index(p_input, threadpool);
+
+/*
+ * Writes the lines in their order, gathered into large buffers.
+ * Buffers are filled on the pool ahead of the one being written (tp may be NULL)
+ * Returns:
+ *	-1 on error
+ *  0 otherwise
+ */
+int output_lines(threadpool, FILE *handle, const char *base, p_line lines, size_t lines_num);
+
+#endif
@@ -0,0 +1,674 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "platform.h"
+#include "threadpool.h"
+#include "linesort.h"
+
+// lines merged in one go before the rest is offered to other workers
+#define MERGE_GRAIN 4096
+
+// below that one qsort beats setting up the buckets
+#define SAMPLE_MIN_LINES 16384
+// sampled lines per bucket, more means more even buckets
+#define SAMPLE_OVERSAMPLING 32
+// more buckets than workers, so a fat one doesn't hold everybody up
+#define SAMPLE_BUCKETS_PER_THREAD 4
+// splitters at most, bucket ids are unsigned short and there are two per splitter
+#define SAMPLE_MAX_SPLITTERS 4095
+// lines classified and scattered by one task
+#define SAMPLE_BLOCK 16384
+
+// below that the prefix kernel does insertion sort
+#define PREFIX_INSERTION 16
+
+// bytes of a line in a prefix, the last byte of it says how many are left
+#define PREFIX_BYTES 7
+
+typedef struct __params {
+	const char *base;
+	p_line lines;
+	size_t num;
+	int kernel;
+} t_params, *p_params;
+
+// a line for the prefix kernel, the key and the view side by side
+typedef struct __record {
+	// the next PREFIX_BYTES of the line big-endian, zero padded past its end,
+	// then how many bytes there were, PREFIX_BYTES + 1 if the line goes on
+	unsigned long long prefix;
+	t_line line;
+} t_record, *p_record;
+
+typedef struct __merge_params {
+	threadpool tp;
+	const char *base;
+	p_line lines;
+	size_t lines_num;
+	int chanks_num;
+	// set by the merge, no memory for its buffer or a round failed
+	int failed;
+} t_merge_params, *p_merge_params;
+
+// one level of the merge tree: runs of src merged pairwise into dst
+typedef struct __merge_round {
+	const char *base;
+	p_line src;
+	p_line dst;
+	// run i is [bounds[i], bounds[i + 1])
+	size_t *bounds;
+	int runs_num;
+} t_merge_round, *p_merge_round;
+
+typedef struct __sample {
+	const char *base;
+	p_line lines;
+	// lines scattered into buckets
+	p_line buckets;
+	size_t lines_num;
+
+	// distinct and in order. Bucket 2 * i gets what is between splitters[i - 1]
+	// and splitters[i], bucket 2 * i + 1 what is equal to splitters[i],
+	// so however many lines are the same they are sorted already
+	p_line splitters;
+	int splitters_num;
+	int buckets_num;
+	// where each bucket starts in buckets, plus the end
+	size_t *bounds;
+
+	int kernel;
+	// bucket of every line, found once and used for counting and scattering
+	unsigned short *ids;
+	int blocks_num;
+	// blocks_num x buckets_num: lines of a block per bucket, then where they go
+	size_t *counts;
+} t_sample, *p_sample;
+
+
+// qsort has no context argument, so the base goes around it
+static OS_THREAD_LOCAL const char *compare_base;
+
+
+	/*	Prototypes	*/
+
+int sort_lines(threadpool tp, const char *base, p_line lines, size_t lines_num, int engine);
+
+static int line_compare(const char *base, p_line a, p_line b, size_t depth);
+static int compare(const void *a, const void *b);
+static void kernel_sort(int kernel, const char *base, p_line lines, size_t num, p_line out);
+
+static void prefix_sort(const char *base, p_line lines, size_t num, p_line out);
+static unsigned long long prefix_at(const char *base, p_line line, size_t depth);
+static void prefix_mkqsort(const char *base, p_record records, size_t num, size_t depth);
+static void prefix_deeper(const char *base, p_record records, size_t num, size_t depth);
+static void prefix_insertion(const char *base, p_record records, size_t num, size_t depth);
+static int prefix_compare(const char *base, p_record a, p_record b, size_t depth);
+
+static int merge_sort_lines(threadpool tp, const char *base, p_line lines, size_t lines_num, int kernel);
+static void* to_thread(void *args);
+static void* to_merge(void *args);
+static void mergesort(const char *base, p_line first, size_t first_len, p_line second, size_t second_len, p_line result);
+static size_t merge_path(const char *base, p_line first, size_t first_len, p_line second, size_t second_len, size_t diagonal);
+static void merge_slice(long begin, long end, void *args);
+static void copy_slice(long begin, long end, void *args);
+static int merge_lines(threadpool tp, const char *base, p_line lines, size_t lines_num, int chanks_num);
+
+static int sample_sort_lines(threadpool tp, const char *base, p_line lines, size_t lines_num, int kernel);
+static int sample_run(threadpool tp, p_sample sample);
+static void sample_splitters(p_sample sample, p_line picked, int picked_num);
+static int sample_bucket(p_sample sample, p_line line);
+static void sample_classify(long begin, long end, void *args);
+static void sample_scatter(long begin, long end, void *args);
+static void sample_sort_buckets(long begin, long end, void *args);
+
+
+int sort_lines(threadpool tp, const char *base, p_line lines, size_t lines_num, int engine)
+{
+	int kernel = engine & SORT_PREFIX;
+	if ((engine & ~SORT_PREFIX) == SORT_SAMPLE)
+		return sample_sort_lines(tp, base, lines, lines_num, kernel);
+	return merge_sort_lines(tp, base, lines, lines_num, kernel);
+}
+
+/*
+ * Bytes first, a line that is a prefix of the other goes first,
+ * the order strcmp gave as long as lines have no NULs in them.
+ * The first depth bytes are known to be equal
+ */
+static int line_compare(const char *base, p_line a, p_line b, size_t depth)
+{
+	size_t length = a->length < b->length ? a->length : b->length;
+	int diff = memcmp(base + a->offset + depth, base + b->offset + depth, length - depth);
+	if (diff != 0)
+		return diff;
+	return a->length < b->length ? -1 : a->length > b->length;
+}
+
+static int compare(const void *a, const void *b) {
+    return line_compare(compare_base, (p_line)a, (p_line)b, 0);
+}
+
+/*
+ * out may be lines itself
+ */
+static void kernel_sort(int kernel, const char *base, p_line lines, size_t num, p_line out)
+{
+	if (kernel == SORT_PREFIX) {
+		prefix_sort(base, lines, num, out);
+		return;
+	}
+	compare_base = base;
+	qsort(lines, num, sizeof(t_line), compare);
+	if (out != lines)
+		memcpy(out, lines, num * sizeof(t_line));
+}
+
+		/*	Prefix kernel	*/
+
+/*
+ * Falls back to qsort if there is no memory for the records
+ */
+static void prefix_sort(const char *base, p_line lines, size_t num, p_line out)
+{
+	p_record records = malloc(num * sizeof(t_record));
+	if (records == NULL) {
+		kernel_sort(SORT_QSORT, base, lines, num, out);
+		return;
+	}
+
+	for (size_t i = 0; i < num; i++) {
+		records[i].prefix = prefix_at(base, &lines[i], 0);
+		records[i].line = lines[i];
+	}
+	prefix_mkqsort(base, records, num, 0);
+	for (size_t i = 0; i < num; i++)
+		out[i] = records[i].line;
+
+	free(records);
+}
+
+/*
+ * Bytes from depth on, never past the end of the line.
+ * Comparing those as integers is comparing them as line_compare would:
+ * equal bytes and the shorter one first
+ */
+static unsigned long long prefix_at(const char *base, p_line line, size_t depth)
+{
+	const unsigned char *bytes = (const unsigned char *)base + line->offset + depth;
+	size_t left = line->length - depth;
+	int taken = left < PREFIX_BYTES ? (int)left : PREFIX_BYTES;
+
+	unsigned long long prefix = 0;
+	for (int i = 0; i < PREFIX_BYTES; i++)
+		prefix = prefix << 8 | (i < taken ? bytes[i] : 0);
+	return prefix << 8 | (left > PREFIX_BYTES ? PREFIX_BYTES + 1 : left);
+}
+
+/*
+ * Three-way quicksort on the prefixes. Records with the pivot's prefix
+ * are done if the line ends in it, otherwise the next PREFIX_BYTES
+ * are loaded and they go around again one level deeper
+ */
+static void prefix_mkqsort(const char *base, p_record records, size_t num, size_t depth)
+{
+	while (num > PREFIX_INSERTION) {
+		// median of three
+		unsigned long long a = records[0].prefix;
+		unsigned long long b = records[num / 2].prefix;
+		unsigned long long c = records[num - 1].prefix;
+		unsigned long long pivot = a < b ? (b < c ? b : (a < c ? c : a)) : (a < c ? a : (b < c ? c : b));
+
+		// [0, less) < pivot, [less, i) == pivot, (greater, num) > pivot
+		size_t less = 0;
+		size_t i = 0;
+		size_t greater = num;
+		while (i < greater) {
+			if (records[i].prefix < pivot) {
+				t_record tmp = records[i];
+				records[i++] = records[less];
+				records[less++] = tmp;
+			}
+			else if (records[i].prefix > pivot) {
+				t_record tmp = records[i];
+				records[i] = records[--greater];
+				records[greater] = tmp;
+			}
+			else
+				i++;
+		}
+
+		// same bytes and same length, nothing left to tell them apart
+		size_t equal = (pivot & 0xff) <= PREFIX_BYTES ? 0 : greater - less;
+		size_t above = num - greater;
+
+		// The biggest part goes around again, the other two are at most half
+		// of num, so however bad the pivots the stack stays log(num) deep
+		if (less >= above && less >= equal) {
+			prefix_deeper(base, &records[less], equal, depth);
+			prefix_mkqsort(base, &records[greater], above, depth);
+			num = less;
+		}
+		else if (above >= equal) {
+			prefix_mkqsort(base, records, less, depth);
+			prefix_deeper(base, &records[less], equal, depth);
+			records = &records[greater];
+			num = above;
+		}
+		else {
+			prefix_mkqsort(base, records, less, depth);
+			prefix_mkqsort(base, &records[greater], above, depth);
+			records = &records[less];
+			num = equal;
+			depth += PREFIX_BYTES;
+			for (size_t j = 0; j < num; j++)
+				records[j].prefix = prefix_at(base, &records[j].line, depth);
+		}
+	}
+	prefix_insertion(base, records, num, depth);
+}
+
+/*
+ * Records that agree up to depth + PREFIX_BYTES, sorted on what comes after
+ */
+static void prefix_deeper(const char *base, p_record records, size_t num, size_t depth)
+{
+	depth += PREFIX_BYTES;
+	for (size_t j = 0; j < num; j++)
+		records[j].prefix = prefix_at(base, &records[j].line, depth);
+	prefix_mkqsort(base, records, num, depth);
+}
+
+static void prefix_insertion(const char *base, p_record records, size_t num, size_t depth)
+{
+	for (size_t i = 1; i < num; i++) {
+		t_record record = records[i];
+		size_t j = i;
+		while (j > 0 && prefix_compare(base, &records[j - 1], &record, depth) > 0) {
+			records[j] = records[j - 1];
+			j--;
+		}
+		records[j] = record;
+	}
+}
+
+/*
+ * Everything before depth is equal already
+ */
+static int prefix_compare(const char *base, p_record a, p_record b, size_t depth)
+{
+	if (a->prefix != b->prefix)
+		return a->prefix < b->prefix ? -1 : 1;
+	if ((a->prefix & 0xff) <= PREFIX_BYTES)
+		return 0;
+	return line_compare(base, &a->line, &b->line, depth + PREFIX_BYTES);
+}
+
+		/*	Merge engine	*/
+
+static int merge_sort_lines(threadpool tp, const char *base, p_line lines, size_t lines_num, int kernel)
+{
+	int thread_num = pool_get_threads_num(tp);
+	size_t per_thread = lines_num / thread_num;
+
+	p_params params = malloc(thread_num * sizeof(t_params));
+	future *sorted = malloc(thread_num * sizeof(future));
+	if (params == NULL || sorted == NULL) {
+		fprintf(stderr, "malloc: NULL\n");
+		free(params);
+		free(sorted);
+		return -1;
+	}
+
+	for (int i = 0; i < thread_num; i++)
+	{
+		params[i].base = base;
+		params[i].lines = &lines[i * per_thread];
+		params[i].num = per_thread;
+		params[i].kernel = kernel;
+	}
+	// the last one has to get the residue
+	params[thread_num - 1].num += lines_num % thread_num;
+
+	// chunks sort on their own, the merge starts right after the last of them
+	t_merge_params merge = { tp, base, lines, lines_num, thread_num, 0 };
+	int submitted = 0;
+	while (submitted < thread_num) {
+		sorted[submitted] = pool_submit(tp, to_thread, (void *)&params[submitted]);
+		if (sorted[submitted] == NULL)
+			break;
+		submitted++;
+	}
+	future merged = NULL;
+	if (submitted == thread_num)
+		merged = pool_add_task_after(tp, sorted, thread_num, to_merge, (void *)&merge);
+
+	// whatever got in reads params and merge off our stack, so it is waited for anyway
+	int ret = -1;
+	if (merged != NULL) {
+		future_wait(merged);
+		future_release(merged);
+		ret = merge.failed ? -1 : 0;
+	}
+	for (int i = 0; i < submitted; i++) {
+		future_wait(sorted[i]);
+		future_release(sorted[i]);
+	}
+	if (ret != 0)
+		fprintf(stderr, "merge_sort_lines: failed\n");
+
+	free(sorted);
+	free(params);
+	return ret;
+}
+
+static void* to_thread(void *args)
+{
+	p_params params = (p_params)args;
+	kernel_sort(params->kernel, params->base, params->lines, params->num, params->lines);
+	return NULL;
+}
+
+static void* to_merge(void *args)
+{
+	p_merge_params params = (p_merge_params)args;
+	params->failed = merge_lines(params->tp, params->base, params->lines, params->lines_num, params->chanks_num) != 0;
+	return NULL;
+}
+
+static void mergesort(const char *base, p_line first, size_t first_len, p_line second, size_t second_len, p_line result)
+{
+	size_t i = 0;
+	size_t j = 0;
+	size_t k = 0;
+	while (i < first_len && j < second_len)
+		if (line_compare(base, &first[i], &second[j], 0) <= 0)
+			result[k++] = first[i++];
+		else
+			result[k++] = second[j++];
+
+	if (i == first_len)
+		while (j < second_len)
+			result[k++] = second[j++];
+	else
+		while (i < first_len)
+			result[k++] = first[i++];
+}
+
+/*
+ * How many of the first `diagonal` merged lines come from first,
+ * ties go to first like in mergesort
+ */
+static size_t merge_path(const char *base, p_line first, size_t first_len, p_line second, size_t second_len, size_t diagonal)
+{
+	size_t low = diagonal > second_len ? diagonal - second_len : 0;
+	size_t high = diagonal < first_len ? diagonal : first_len;
+	while (low < high) {
+		size_t middle = low + (high - low) / 2;
+		if (line_compare(base, &first[middle], &second[diagonal - middle - 1], 0) <= 0)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	return low;
+}
+
+/*
+ * Produces dst[begin, end) of one round, whatever pairs of runs it spans.
+ * Both ends are cut with merge_path, so slices don't depend on each other
+ */
+static void merge_slice(long begin, long end, void *args)
+{
+	p_merge_round round = (p_merge_round)args;
+	size_t *bounds = round->bounds;
+	size_t low = (size_t)begin;
+	size_t high = (size_t)end;
+
+	// the pair begin falls into
+	int pair = 0;
+	while (pair + 2 < round->runs_num && bounds[pair + 2] <= low)
+		pair += 2;
+
+	for (; pair < round->runs_num && bounds[pair] < high; pair += 2) {
+		size_t start = bounds[pair];
+		size_t middle = bounds[pair + 1];
+		// an odd run out is merged with nothing, i.e. copied
+		size_t stop = pair + 2 <= round->runs_num ? bounds[pair + 2] : middle;
+
+		size_t from = (low > start ? low : start) - start;
+		size_t to = (high < stop ? high : stop) - start;
+		p_line first = &round->src[start];
+		p_line second = &round->src[middle];
+		size_t i = merge_path(round->base, first, middle - start, second, stop - middle, from);
+		size_t j = merge_path(round->base, first, middle - start, second, stop - middle, to);
+		mergesort(round->base, &first[i], j - i, &second[from - i], (to - j) - (from - i),
+				&round->dst[start + from]);
+	}
+}
+
+static void copy_slice(long begin, long end, void *args)
+{
+	p_merge_round round = (p_merge_round)args;
+	memcpy(&round->dst[begin], &round->src[begin], (end - begin) * sizeof(t_line));
+}
+
+/*
+ * Pairwise merge tree, log2(chanks_num) rounds going back and forth
+ * between lines and a buffer, every round split over the pool by merge_path.
+ * O(n log k) in total, and no copying back except maybe once at the end
+ * Returns:
+ *	-1 on error, lines are left unmerged
+ * 	0 otherwise
+ */
+static int merge_lines(threadpool tp, const char *base, p_line lines, size_t lines_num, int chanks_num)
+{
+	if (chanks_num <= 1 || lines_num == 0)
+		return 0;
+
+	p_line buffer = malloc(sizeof(t_line) * lines_num);
+	size_t *bounds = malloc(sizeof(size_t) * (chanks_num + 1));
+	if (buffer == NULL || bounds == NULL) {
+		fprintf(stderr, "malloc: NULL\n");
+		free(buffer);
+		free(bounds);
+		return -1;
+	}
+
+	// same chunks merge_sort_lines gave out, the residue is on the last one
+	size_t per_chank = lines_num / chanks_num;
+	for (int i = 0; i < chanks_num; i++)
+		bounds[i] = i * per_chank;
+	bounds[chanks_num] = lines_num;
+
+	int ret = 0;
+	t_merge_round round = { base, lines, buffer, bounds, chanks_num };
+	while (ret == 0 && round.runs_num > 1) {
+		ret = pool_parallel_for(tp, 0, (long)lines_num, MERGE_GRAIN, merge_slice, (void *)&round);
+
+		// every other bound is gone
+		int runs_num = (round.runs_num + 1) / 2;
+		for (int i = 1; i < runs_num; i++)
+			bounds[i] = bounds[2 * i];
+		bounds[runs_num] = lines_num;
+		round.runs_num = runs_num;
+
+		p_line merged = round.dst;
+		round.dst = round.src;
+		round.src = merged;
+	}
+	if (ret == 0 && round.src != lines)
+		ret = pool_parallel_for(tp, 0, (long)lines_num, MERGE_GRAIN, copy_slice, (void *)&round);
+
+	free(bounds);
+	free(buffer);
+	return ret;
+}
+
+		/*	Sample engine	*/
+
+/*
+ * Splitters from a sample, every line classified and scattered into
+ * its bucket in parallel blocks, then buckets sorted independently.
+ * Buckets are disjoint and in order, so there is nothing to merge
+ */
+static int sample_sort_lines(threadpool tp, const char *base, p_line lines, size_t lines_num, int kernel)
+{
+	if (lines_num < SAMPLE_MIN_LINES || pool_get_threads_num(tp) == 1) {
+		kernel_sort(kernel, base, lines, lines_num, lines);
+		return 0;
+	}
+
+	t_sample sample;
+	sample.kernel = kernel;
+	sample.base = base;
+	sample.lines = lines;
+	sample.lines_num = lines_num;
+	sample.splitters_num = pool_get_threads_num(tp) * SAMPLE_BUCKETS_PER_THREAD - 1;
+	if (sample.splitters_num > SAMPLE_MAX_SPLITTERS)
+		sample.splitters_num = SAMPLE_MAX_SPLITTERS;
+	// as many as there can be, sample_splitters drops the repeated ones
+	sample.buckets_num = 2 * sample.splitters_num + 1;
+	sample.blocks_num = (lines_num + SAMPLE_BLOCK - 1) / SAMPLE_BLOCK;
+
+	int picked_num = (sample.splitters_num + 1) * SAMPLE_OVERSAMPLING;
+	p_line picked = malloc(picked_num * sizeof(t_line));
+	sample.splitters = malloc(sample.splitters_num * sizeof(t_line));
+	sample.buckets = malloc(lines_num * sizeof(t_line));
+	sample.bounds = malloc((sample.buckets_num + 1) * sizeof(size_t));
+	sample.ids = malloc(lines_num * sizeof(unsigned short));
+	sample.counts = calloc((size_t)sample.blocks_num * sample.buckets_num, sizeof(size_t));
+	int ret = -1;
+	if (picked == NULL || sample.splitters == NULL || sample.buckets == NULL ||
+			sample.bounds == NULL || sample.ids == NULL || sample.counts == NULL)
+		fprintf(stderr, "sample_sort_lines: malloc\n");
+	else {
+		sample_splitters(&sample, picked, picked_num);
+		ret = sample_run(tp, &sample);
+	}
+
+	free(sample.counts);
+	free(sample.ids);
+	free(sample.bounds);
+	free(sample.buckets);
+	free(sample.splitters);
+	free(picked);
+	return ret;
+}
+
+/*
+ * Returns:
+ *	-1 on error
+ *  0 otherwise
+ */
+static int sample_run(threadpool tp, p_sample sample)
+{
+	if (pool_parallel_for(tp, 0, sample->blocks_num, 1, sample_classify, (void *)sample) != 0)
+		return -1;
+
+	// counts become offsets, bucket by bucket and block by block in each
+	size_t offset = 0;
+	for (int bucket = 0; bucket < sample->buckets_num; bucket++) {
+		sample->bounds[bucket] = offset;
+		for (int block = 0; block < sample->blocks_num; block++) {
+			size_t *count = &sample->counts[(size_t)block * sample->buckets_num + bucket];
+			size_t lines_in = *count;
+			*count = offset;
+			offset += lines_in;
+		}
+	}
+	sample->bounds[sample->buckets_num] = offset;
+
+	if (pool_parallel_for(tp, 0, sample->blocks_num, 1, sample_scatter, (void *)sample) != 0)
+		return -1;
+	return pool_parallel_for(tp, 0, sample->buckets_num, 1, sample_sort_buckets, (void *)sample);
+}
+
+/*
+ * Evenly spaced lines of a sorted random sample, each one once.
+ * The generator is fixed, runs are reproducible
+ */
+static void sample_splitters(p_sample sample, p_line picked, int picked_num)
+{
+	unsigned long long state = 0x9e3779b97f4a7c15ull;
+	for (int i = 0; i < picked_num; i++) {
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		picked[i] = sample->lines[state % sample->lines_num];
+	}
+	kernel_sort(SORT_QSORT, sample->base, picked, picked_num, picked);
+
+	int wanted = sample->splitters_num;
+	sample->splitters_num = 0;
+	for (int i = 1; i <= wanted; i++) {
+		p_line splitter = &picked[(size_t)i * picked_num / (wanted + 1)];
+		if (sample->splitters_num > 0 &&
+				line_compare(sample->base, &sample->splitters[sample->splitters_num - 1], splitter, 0) == 0)
+			continue;
+		sample->splitters[sample->splitters_num++] = *splitter;
+	}
+	sample->buckets_num = 2 * sample->splitters_num + 1;
+}
+
+/*
+ * Below the first splitter not below the line, or equal to it
+ */
+static int sample_bucket(p_sample sample, p_line line)
+{
+	int low = 0;
+	int high = sample->splitters_num;
+	while (low < high) {
+		int middle = low + (high - low) / 2;
+		if (line_compare(sample->base, &sample->splitters[middle], line, 0) < 0)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	if (low < sample->splitters_num && line_compare(sample->base, &sample->splitters[low], line, 0) == 0)
+		return 2 * low + 1;
+	return 2 * low;
+}
+
+static void sample_classify(long begin, long end, void *args)
+{
+	p_sample sample = (p_sample)args;
+	for (long block = begin; block < end; block++) {
+		size_t *counts = &sample->counts[(size_t)block * sample->buckets_num];
+		size_t first = (size_t)block * SAMPLE_BLOCK;
+		size_t last = first + SAMPLE_BLOCK < sample->lines_num ? first + SAMPLE_BLOCK : sample->lines_num;
+		for (size_t i = first; i < last; i++) {
+			int bucket = sample_bucket(sample, &sample->lines[i]);
+			sample->ids[i] = (unsigned short)bucket;
+			counts[bucket]++;
+		}
+	}
+}
+
+static void sample_scatter(long begin, long end, void *args)
+{
+	p_sample sample = (p_sample)args;
+	for (long block = begin; block < end; block++) {
+		size_t *offsets = &sample->counts[(size_t)block * sample->buckets_num];
+		size_t first = (size_t)block * SAMPLE_BLOCK;
+		size_t last = first + SAMPLE_BLOCK < sample->lines_num ? first + SAMPLE_BLOCK : sample->lines_num;
+		for (size_t i = first; i < last; i++)
+			sample->buckets[offsets[sample->ids[i]]++] = sample->lines[i];
+	}
+}
+
+/*
+ * Sorted where they were scattered and put straight back in place,
+ * the lines equal to a splitter just put back
+ */
+static void sample_sort_buckets(long begin, long end, void *args)
+{
+	p_sample sample = (p_sample)args;
+	for (long bucket = begin; bucket < end; bucket++) {
+		size_t first = sample->bounds[bucket];
+		size_t num = sample->bounds[bucket + 1] - first;
+		if (bucket % 2 == 1)
+			memcpy(&sample->lines[first], &sample->buckets[first], num * sizeof(t_line));
+		else
+			kernel_sort(sample->kernel, sample->base, &sample->buckets[first], num, &sample->lines[first]);
+	}
+}
@@ -0,0 +1,36 @@
+#ifndef H_LINESORT
+#define H_LINESORT
+
+#include <stddef.h>
+
+#include "threadpool.h"
+#include "lineio.h"
+
+/*
+ * Engines of sort_lines
+ *	SORT_MERGE	a chunk per worker sorted on its own, then a merge tree
+ *	SORT_SAMPLE	splitters from a sample, lines go to disjoint buckets sorted on their own.
+ *			Within noise of the merge tree in bench_sort so far, hence not the default
+ */
+#define SORT_MERGE	0
+#define SORT_SAMPLE	1
+
+/*
+ * What sorts the buckets or chunks, or'ed into the engine
+ *	SORT_QSORT	libc qsort with strcmp
+ *	SORT_PREFIX	multikey quicksort on 7 byte prefixes kept next to the views,
+ *			the lines themselves are read only when prefixes tie
+ */
+#define SORT_QSORT	0x00
+#define SORT_PREFIX	0x10
+
+/*
+ * Sorts views into base bytewise, a line that is a prefix of another goes first.
+ * Uses the pool's workers, and the output is the same whatever engine and kernel do it
+ * Returns:
+ *	-1 on error
+ *  0 otherwise
+ */
+int sort_lines(threadpool, const char *base, p_line lines, size_t lines_num, int engine);
+
+#endif
@@ -0,0 +1,87 @@
+#include "platform.h"
+
+	/*	Event functions	*/
+
+void os_event_init(os_event *event)
+{
+	atomic_init(&event->state, 0);
+	atomic_init(&event->waiters, 0);
+}
+
+void os_event_destroy(os_event *event)
+{
+	// nothing is owned by the kernel
+	(void)event;
+}
+
+void os_event_set(os_event *event)
+{
+	atomic_store(&event->state, 1);
+	// paired with the increment in os_event_wait
+	// either we see the waiter or it sees the state
+	if (atomic_load(&event->waiters) != 0)
+		os_futex_wake(&event->state, 1);
+}
+
+void os_event_wait(os_event *event)
+{
+	// auto reset: whoever swaps 1 -> 0 consumes the signal
+	while (atomic_exchange(&event->state, 0) == 0) {
+		atomic_fetch_add(&event->waiters, 1);
+		os_futex_wait(&event->state, 0);
+		atomic_fetch_sub(&event->waiters, 1);
+	}
+}
+
+	/*	Eventcount functions	*/
+
+void os_eventcount_init(os_eventcount *count)
+{
+	atomic_init(&count->epoch, 0);
+	atomic_init(&count->waiters, 0);
+}
+
+int os_eventcount_prepare(os_eventcount *count)
+{
+	// paired with the fence in os_eventcount_notify:
+	// either the notifier sees us or our recheck sees its condition
+	atomic_fetch_add(&count->waiters, 1);
+	return atomic_load(&count->epoch);
+}
+
+void os_eventcount_cancel(os_eventcount *count)
+{
+	atomic_fetch_sub(&count->waiters, 1);
+}
+
+void os_eventcount_wait(os_eventcount *count, int key)
+{
+	while (atomic_load(&count->epoch) == key)
+		os_futex_wait(&count->epoch, key);
+	atomic_fetch_sub(&count->waiters, 1);
+}
+
+int os_eventcount_wait_for(os_eventcount *count, int key, long long ns)
+{
+	long long deadline = os_now_ns() + ns;
+	while (atomic_load(&count->epoch) == key) {
+		long long left = deadline - os_now_ns();
+		if (left <= 0) {
+			atomic_fetch_sub(&count->waiters, 1);
+			return -1;
+		}
+		os_futex_wait_for(&count->epoch, key, left);
+	}
+	atomic_fetch_sub(&count->waiters, 1);
+	return 0;
+}
+
+void os_eventcount_notify(os_eventcount *count, int n)
+{
+	atomic_thread_fence(memory_order_seq_cst);
+	if (atomic_load_explicit(&count->waiters, memory_order_relaxed) == 0)
+		return;
+
+	atomic_fetch_add(&count->epoch, 1);
+	os_futex_wake(&count->epoch, n);
+}
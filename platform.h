@@ -0,0 +1,199 @@
+#ifndef H_PLATFORM
+#define H_PLATFORM
+/*
+ * Thin layer over the OS.
+ * Everything above it (pool, queues) must not include OS headers directly.
+ * Backends: platform_win32.c, platform_linux.c (pthreads + futex)
+ */
+#include <stdatomic.h>
+#include <stddef.h>
+
+#ifdef _WIN32
+#include <windows.h>
+
+typedef CRITICAL_SECTION os_mutex;
+typedef HANDLE os_thread;
+
+#define OS_THREAD_LOCAL __declspec(thread)
+
+// tells the core we are in a spin loop
+#define os_cpu_relax() YieldProcessor()
+
+#else
+#include <pthread.h>
+
+typedef pthread_mutex_t os_mutex;
+typedef pthread_t os_thread;
+
+#define OS_THREAD_LOCAL _Thread_local
+
+#if defined(__x86_64__) || defined(__i386__)
+#define os_cpu_relax() __builtin_ia32_pause()
+#elif defined(__aarch64__)
+#define os_cpu_relax() __asm__ __volatile__("yield" ::: "memory")
+#else
+#define os_cpu_relax() ((void)0)
+#endif
+
+#endif
+
+// for padding anything written by different threads
+#define CACHE_LINE 64
+
+/*
+ * Auto-reset event, the same thing CreateEventA(NULL, FALSE, FALSE, NULL) gives.
+ * Built on top of os_futex_*, so setting an event nobody waits on
+ * costs no syscall.
+ */
+typedef struct __event {
+	atomic_int state;
+	atomic_int waiters;
+} os_event;
+
+/*
+ * Eventcount: a waiter takes a key, checks its condition once more and waits
+ * only if nothing was notified since. Notifying with nobody waiting is a load.
+ */
+typedef struct __eventcount {
+	atomic_int epoch;
+	atomic_int waiters;
+} os_eventcount;
+
+
+	/*	Mutex	*/
+
+void os_mutex_init(os_mutex *);
+void os_mutex_destroy(os_mutex *);
+void os_mutex_lock(os_mutex *);
+void os_mutex_unlock(os_mutex *);
+
+	/*	Event	*/
+
+void os_event_init(os_event *);
+void os_event_destroy(os_event *);
+void os_event_set(os_event *);
+void os_event_wait(os_event *);
+
+	/*	Eventcount	*/
+
+void os_eventcount_init(os_eventcount *);
+
+/*
+ * Counts us as a waiter
+ * Returns:
+ *	the key for os_eventcount_wait
+ */
+int os_eventcount_prepare(os_eventcount *);
+
+/*
+ * The condition came true after all, stops counting us
+ */
+void os_eventcount_cancel(os_eventcount *);
+
+/*
+ * Blocks until a notify newer than the key, then stops counting us
+ */
+void os_eventcount_wait(os_eventcount *, int key);
+
+/*
+ * Same as os_eventcount_wait, but gives up after ns nanoseconds
+ * Returns:
+ *	-1 on timeout
+ *  0 otherwise
+ */
+int os_eventcount_wait_for(os_eventcount *, int key, long long ns);
+
+/*
+ * Wakes up to n waiters, n < 0 wakes everyone.
+ * The condition must have been made true before
+ */
+void os_eventcount_notify(os_eventcount *, int n);
+
+	/*	Futex	*/
+
+/*
+ * Blocks while *addr == expected.
+ * May return spuriously, the caller must recheck its condition
+ */
+void os_futex_wait(atomic_int *addr, int expected);
+
+/*
+ * Same as os_futex_wait, but gives up after about ns nanoseconds
+ */
+void os_futex_wait_for(atomic_int *addr, int expected, long long ns);
+
+/*
+ * Wakes up to n threads blocked on addr, n < 0 wakes everyone
+ */
+void os_futex_wake(atomic_int *addr, int n);
+
+	/*	Thread	*/
+
+/*
+ * Returns:
+ *	-1 on error
+ * 	0 otherwise
+ */
+int os_thread_create(os_thread *, void (*fun)(void *), void *args);
+
+void os_thread_join(os_thread);
+
+/*
+ * Gives the rest of the time slice away
+ */
+void os_thread_yield(void);
+
+/*
+ * Returns:
+ *	processors online, at least 1
+ */
+int os_cpu_count(void);
+
+/*
+ * Pins the calling thread to the processor
+ * Returns:
+ *	-1 on error
+ * 	0 otherwise
+ */
+int os_thread_pin(int cpu);
+
+	/*	Topology	*/
+
+/*
+ * Where a processor sits, -1 for what is unknown
+ */
+typedef struct __cpu_info {
+	int cpu;
+	int core;
+	int package;
+	int node;
+	// hardware threads of the same core before this one
+	int sibling;
+} os_cpu_info;
+
+/*
+ * Fills in up to n processors this process may run on, by number
+ * Returns:
+ *	how many there are, 0 if it can't tell
+ */
+int os_cpu_topology(os_cpu_info *cpus, int n);
+
+	/*	Time	*/
+
+/*
+ * Monotonic clock
+ */
+long long os_now_ns(void);
+
+	/*	Files	*/
+
+/*
+ * Maps a whole regular file read-only, hinted to be read front to back
+ * Returns:
+ *	NULL on error, on an empty file, or if it can't be mapped (a pipe)
+ */
+void* os_map_file(const char *path, size_t *size);
+
+void os_unmap_file(void *data, size_t size);
+
+#endif
@@ -0,0 +1,241 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+#include <limits.h>
+#include <time.h>
+#include <sched.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "platform.h"
+
+typedef struct __start {
+	void (*fun)(void *);
+	void *args;
+} t_start, *p_start;
+
+static void *thread_start(void *);
+static int sys_read_int(int cpu, const char *name);
+static int sys_cpu_node(int cpu);
+
+	/*	Mutex functions	*/
+
+void os_mutex_init(os_mutex *mutex)
+{
+	pthread_mutex_init(mutex, NULL);
+}
+
+void os_mutex_destroy(os_mutex *mutex)
+{
+	pthread_mutex_destroy(mutex);
+}
+
+void os_mutex_lock(os_mutex *mutex)
+{
+	pthread_mutex_lock(mutex);
+}
+
+void os_mutex_unlock(os_mutex *mutex)
+{
+	pthread_mutex_unlock(mutex);
+}
+
+	/*	Futex functions	*/
+
+void os_futex_wait(atomic_int *addr, int expected)
+{
+	// the pool never shares its futexes between processes
+	syscall(SYS_futex, (int *)addr, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+}
+
+void os_futex_wait_for(atomic_int *addr, int expected, long long ns)
+{
+	struct timespec timeout;
+	timeout.tv_sec = ns / 1000000000LL;
+	timeout.tv_nsec = ns % 1000000000LL;
+	syscall(SYS_futex, (int *)addr, FUTEX_WAIT_PRIVATE, expected, &timeout, NULL, 0);
+}
+
+void os_futex_wake(atomic_int *addr, int n)
+{
+	if (n < 0)
+		n = INT_MAX;
+	syscall(SYS_futex, (int *)addr, FUTEX_WAKE_PRIVATE, n, NULL, NULL, 0);
+}
+
+	/*	Thread functions	*/
+
+int os_thread_create(os_thread *thread, void (*fun)(void *), void *args)
+{
+	p_start start = malloc(sizeof(t_start));
+	if (start == NULL) {
+		fprintf(stderr, "os_thread_create: malloc\n");
+		return -1;
+	}
+	start->fun = fun;
+	start->args = args;
+
+	int err = pthread_create(thread, NULL, thread_start, start);
+	if (err != 0) {
+		fprintf(stderr, "pthread_create: %d\n", err);
+		free(start);
+		return -1;
+	}
+	return 0;
+}
+
+void os_thread_join(os_thread thread)
+{
+	pthread_join(thread, NULL);
+}
+
+void os_thread_yield(void)
+{
+	sched_yield();
+}
+
+int os_cpu_count(void)
+{
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return count > 0 ? (int)count : 1;
+}
+
+int os_thread_pin(int cpu)
+{
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+		fprintf(stderr, "sched_setaffinity: %d\n", errno);
+		return -1;
+	}
+	return 0;
+}
+
+static void *thread_start(void *s)
+{
+	t_start start = *(p_start)s;
+	free(s);
+
+	start.fun(start.args);
+	return NULL;
+}
+
+	/*	Topology functions	*/
+
+/*
+ * Straight from /sys, no libnuma
+ */
+int os_cpu_topology(os_cpu_info *cpus, int n)
+{
+	cpu_set_t allowed;
+	if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+		return 0;
+
+	int count = 0;
+	for (int cpu = 0; cpu < CPU_SETSIZE && count < n; cpu++) {
+		if (!CPU_ISSET(cpu, &allowed))
+			continue;
+
+		os_cpu_info *info = &cpus[count++];
+		info->cpu = cpu;
+		info->core = sys_read_int(cpu, "topology/core_id");
+		info->package = sys_read_int(cpu, "topology/physical_package_id");
+		info->node = sys_cpu_node(cpu);
+		info->sibling = 0;
+		for (int i = 0; i < count - 1 && info->core >= 0; i++)
+			if (cpus[i].core == info->core && cpus[i].package == info->package)
+				info->sibling++;
+	}
+	return count;
+}
+
+/*
+ * Returns:
+ *	-1 on error
+ *	the number in /sys/devices/system/cpu/cpu<cpu>/<name> otherwise
+ */
+static int sys_read_int(int cpu, const char *name)
+{
+	char path[128];
+	snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/%s", cpu, name);
+	FILE *file = fopen(path, "r");
+	if (file == NULL)
+		return -1;
+
+	int value;
+	if (fscanf(file, "%d", &value) != 1)
+		value = -1;
+	fclose(file);
+	return value;
+}
+
+/*
+ * The cpu's directory links to its node as node<N>
+ * Returns:
+ *	-1 without NUMA
+ *	the node otherwise
+ */
+static int sys_cpu_node(int cpu)
+{
+	char path[64];
+	snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+	DIR *dir = opendir(path);
+	if (dir == NULL)
+		return -1;
+
+	int node = -1;
+	struct dirent *entry;
+	while (node < 0 && (entry = readdir(dir)) != NULL)
+		if (sscanf(entry->d_name, "node%d", &node) != 1)
+			node = -1;
+	closedir(dir);
+	return node;
+}
+
+	/*	Time functions	*/
+
+long long os_now_ns(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+	/*	File functions	*/
+
+void* os_map_file(const char *path, size_t *size)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size == 0) {
+		close(fd);
+		return NULL;
+	}
+
+	void *data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	// the mapping keeps the file
+	close(fd);
+	if (data == MAP_FAILED)
+		return NULL;
+
+	// advice values are not flags, one call each
+	madvise(data, info.st_size, MADV_SEQUENTIAL);
+	madvise(data, info.st_size, MADV_WILLNEED);
+	*size = info.st_size;
+	return data;
+}
+
+void os_unmap_file(void *data, size_t size)
+{
+	munmap(data, size);
+}
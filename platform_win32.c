@@ -0,0 +1,189 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "platform.h"
+
+typedef struct __start {
+	void (*fun)(void *);
+	void *args;
+} t_start, *p_start;
+
+static unsigned long int WINAPI thread_start(void *);
+
+	/*	Mutex functions	*/
+
+void os_mutex_init(os_mutex *mutex)
+{
+	InitializeCriticalSection(mutex);
+}
+
+void os_mutex_destroy(os_mutex *mutex)
+{
+	DeleteCriticalSection(mutex);
+}
+
+void os_mutex_lock(os_mutex *mutex)
+{
+	EnterCriticalSection(mutex);
+}
+
+void os_mutex_unlock(os_mutex *mutex)
+{
+	LeaveCriticalSection(mutex);
+}
+
+	/*	Futex functions	*/
+
+// WaitOnAddress is the closest thing Windows has to a futex (Windows 8+)
+void os_futex_wait(atomic_int *addr, int expected)
+{
+	WaitOnAddress((volatile void *)addr, &expected, sizeof(int), INFINITE);
+}
+
+void os_futex_wait_for(atomic_int *addr, int expected, long long ns)
+{
+	// rounded up, so a short wait doesn't turn into a busy loop
+	DWORD ms = (DWORD)((ns + 999999) / 1000000);
+	WaitOnAddress((volatile void *)addr, &expected, sizeof(int), ms);
+}
+
+void os_futex_wake(atomic_int *addr, int n)
+{
+	if (n == 1)
+		WakeByAddressSingle((void *)addr);
+	else
+		WakeByAddressAll((void *)addr);
+}
+
+	/*	Thread functions	*/
+
+int os_thread_create(os_thread *thread, void (*fun)(void *), void *args)
+{
+	p_start start = malloc(sizeof(t_start));
+	if (start == NULL) {
+		fprintf(stderr, "os_thread_create: malloc\n");
+		return -1;
+	}
+	start->fun = fun;
+	start->args = args;
+
+	*thread = CreateThread(NULL, 0, thread_start, (void *)start, 0, NULL);
+	if (*thread == NULL) {
+		fprintf(stderr, "CreateThread: %lu\n", GetLastError());
+		free(start);
+		return -1;
+	}
+	return 0;
+}
+
+void os_thread_join(os_thread thread)
+{
+	WaitForSingleObject(thread, INFINITE);
+	CloseHandle(thread);
+}
+
+void os_thread_yield(void)
+{
+	SwitchToThread();
+}
+
+int os_cpu_count(void)
+{
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+}
+
+int os_thread_pin(int cpu)
+{
+	if (cpu >= (int)(sizeof(DWORD_PTR) * 8) ||
+			SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) == 0) {
+		fprintf(stderr, "SetThreadAffinityMask: %lu\n", GetLastError());
+		return -1;
+	}
+	return 0;
+}
+
+static unsigned long int WINAPI thread_start(void *s)
+{
+	t_start start = *(p_start)s;
+	free(s);
+
+	start.fun(start.args);
+	return 0;
+}
+
+	/*	Topology functions	*/
+
+/*
+ * Processor group 0 only, and hardware threads of one core aren't told apart
+ */
+int os_cpu_topology(os_cpu_info *cpus, int n)
+{
+	DWORD_PTR process, system;
+	if (!GetProcessAffinityMask(GetCurrentProcess(), &process, &system))
+		return 0;
+
+	int count = 0;
+	for (int cpu = 0; cpu < (int)(sizeof(DWORD_PTR) * 8) && count < n; cpu++) {
+		if (!((process >> cpu) & 1))
+			continue;
+
+		UCHAR node;
+		os_cpu_info *info = &cpus[count++];
+		info->cpu = cpu;
+		info->core = -1;
+		info->package = -1;
+		info->node = GetNumaProcessorNode((UCHAR)cpu, &node) ? node : -1;
+		info->sibling = 0;
+	}
+	return count;
+}
+
+	/*	Time functions	*/
+
+long long os_now_ns(void)
+{
+	static LARGE_INTEGER frequency;
+	LARGE_INTEGER now;
+	if (frequency.QuadPart == 0)
+		QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&now);
+	return (long long)((double)now.QuadPart * 1e9 / (double)frequency.QuadPart);
+}
+
+	/*	File functions	*/
+
+void* os_map_file(const char *path, size_t *size)
+{
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+			OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return NULL;
+
+	LARGE_INTEGER file_size;
+	if (GetFileType(file) != FILE_TYPE_DISK || !GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+		CloseHandle(file);
+		return NULL;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+	if (mapping == NULL)
+		return NULL;
+
+	// the view keeps the mapping
+	void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	if (data == NULL)
+		return NULL;
+
+	*size = (size_t)file_size.QuadPart;
+	return data;
+}
+
+void os_unmap_file(void *data, size_t size)
+{
+	(void)size;
+	UnmapViewOfFile(data);
+}
@@ -0,0 +1,173 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "platform.h"
+#include "slab.h"
+
+typedef struct __free {
+	struct __free *next;
+} t_free, *p_free;
+
+typedef struct __chunk {
+	struct __chunk *next;
+} t_chunk, *p_chunk;
+
+typedef struct __slab {
+	int object_size;
+	int objects_per_chunk;
+
+	// owner side
+	p_chunk chunks;
+	p_free free_list;
+	atomic_long allocs;
+	atomic_long chunks_num;
+	atomic_long frees;
+
+	// everybody else
+	char pad[CACHE_LINE];
+	_Atomic(p_free) remote_list;
+	atomic_long remote_frees;
+} t_slab, *p_slab;
+
+
+	/*	Prototypes	*/
+
+p_slab slab_create(int object_size, int objects_per_chunk);
+void slab_destroy(p_slab slab);
+void* slab_alloc(p_slab slab);
+void slab_free(p_slab slab, void *object);
+void slab_free_remote(p_slab slab, void *object);
+void slab_get_stats(p_slab slab, slab_stats *stats);
+
+static int chunk_create(p_slab slab);
+static void counter_inc(atomic_long *counter);
+
+
+	/*	Slab functions	*/
+
+p_slab slab_create(int object_size, int objects_per_chunk)
+{
+	if (object_size <= 0 || objects_per_chunk <= 0)
+		return NULL;
+
+	p_slab slab = malloc(sizeof(t_slab));
+	if (slab == NULL)
+		return NULL;
+
+	// every object has to be able to hold a link while it is free
+	if (object_size < (int)sizeof(t_free))
+		object_size = sizeof(t_free);
+	// and keep the alignment malloc would have given it
+	object_size = (object_size + sizeof(void *) * 2 - 1) & ~(int)(sizeof(void *) * 2 - 1);
+
+	slab->object_size = object_size;
+	slab->objects_per_chunk = objects_per_chunk;
+	slab->chunks = NULL;
+	slab->free_list = NULL;
+	atomic_init(&slab->allocs, 0);
+	atomic_init(&slab->chunks_num, 0);
+	atomic_init(&slab->frees, 0);
+	atomic_init(&slab->remote_list, NULL);
+	atomic_init(&slab->remote_frees, 0);
+	return slab;
+}
+
+void slab_destroy(p_slab slab)
+{
+	if (slab == NULL)
+		return;
+
+	while (slab->chunks != NULL) {
+		p_chunk next = slab->chunks->next;
+		free(slab->chunks);
+		slab->chunks = next;
+	}
+	free(slab);
+}
+
+void* slab_alloc(p_slab slab)
+{
+	if (slab->free_list == NULL)
+		// take back everything other threads have returned
+		slab->free_list = atomic_exchange_explicit(&slab->remote_list, NULL, memory_order_acquire);
+
+	if (slab->free_list == NULL && chunk_create(slab) != 0)
+		return NULL;
+
+	p_free object = slab->free_list;
+	slab->free_list = object->next;
+	counter_inc(&slab->allocs);
+	return object;
+}
+
+void slab_free(p_slab slab, void *object)
+{
+	if (object == NULL)
+		return;
+
+	p_free node = (p_free)object;
+	node->next = slab->free_list;
+	slab->free_list = node;
+	counter_inc(&slab->frees);
+}
+
+void slab_free_remote(p_slab slab, void *object)
+{
+	if (object == NULL)
+		return;
+
+	// only pushes and whole-list exchanges, so no ABA
+	p_free node = (p_free)object;
+	p_free head = atomic_load_explicit(&slab->remote_list, memory_order_relaxed);
+	do
+		node->next = head;
+	while (!atomic_compare_exchange_weak_explicit(&slab->remote_list, &head, node,
+			memory_order_release, memory_order_relaxed));
+	atomic_fetch_add_explicit(&slab->remote_frees, 1, memory_order_relaxed);
+}
+
+void slab_get_stats(p_slab slab, slab_stats *stats)
+{
+	stats->allocs = atomic_load_explicit(&slab->allocs, memory_order_relaxed);
+	stats->chunks = atomic_load_explicit(&slab->chunks_num, memory_order_relaxed);
+	stats->frees = atomic_load_explicit(&slab->frees, memory_order_relaxed);
+	stats->remote_frees = atomic_load_explicit(&slab->remote_frees, memory_order_relaxed);
+}
+
+		/*	Chunk functions	*/
+
+/*
+ * Returns:
+ *	-1 on error
+ * 	0 otherwise
+ */
+static int chunk_create(p_slab slab)
+{
+	// the header is padded the same way objects are
+	size_t header = (sizeof(t_chunk) + sizeof(void *) * 2 - 1) & ~(sizeof(void *) * 2 - 1);
+	p_chunk chunk = malloc(header + (size_t)slab->object_size * slab->objects_per_chunk);
+	if (chunk == NULL) {
+		fprintf(stderr, "chunk_create: malloc\n");
+		return -1;
+	}
+	chunk->next = slab->chunks;
+	slab->chunks = chunk;
+
+	char *objects = (char *)chunk + header;
+	for (int i = slab->objects_per_chunk - 1; i >= 0; i--) {
+		p_free node = (p_free)(objects + (size_t)i * slab->object_size);
+		node->next = slab->free_list;
+		slab->free_list = node;
+	}
+	counter_inc(&slab->chunks_num);
+	return 0;
+}
+
+/*
+ * Single writer, so no need for a locked add
+ */
+static void counter_inc(atomic_long *counter)
+{
+	long value = atomic_load_explicit(counter, memory_order_relaxed);
+	atomic_store_explicit(counter, value + 1, memory_order_relaxed);
+}
@@ -0,0 +1,53 @@
+#ifndef H_SLAB
+#define H_SLAB
+/*
+ * Cache of fixed size objects carved out of bigger chunks.
+ * Freed objects are recycled instead of going back to free(),
+ * chunks are only released by slab_destroy.
+ *
+ * A slab has an owner: a single thread, or whoever holds the lock
+ * protecting it. Only the owner may call slab_alloc and slab_free,
+ * everyone else returns objects with slab_free_remote.
+ */
+typedef struct __slab* slab;
+
+typedef struct __slab_stats {
+	long allocs;
+	// trips to malloc, stays flat once the cache is warm
+	long chunks;
+	long frees;
+	long remote_frees;
+} slab_stats;
+
+/*
+ * Returns:
+ *	NULL on error
+ */
+slab slab_create(int object_size, int objects_per_chunk);
+
+/*
+ * Releases every chunk, objects still in use included
+ */
+void slab_destroy(slab);
+
+/*
+ * Owner only
+ * Returns:
+ *	NULL on error
+ */
+void* slab_alloc(slab);
+
+/*
+ * Owner only
+ */
+void slab_free(slab, void*);
+
+/*
+ * Any thread, lock-free.
+ * The owner picks those up once its own free list runs dry
+ */
+void slab_free_remote(slab, void*);
+
+void slab_get_stats(slab, slab_stats*);
+
+#endif
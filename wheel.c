@@ -0,0 +1,327 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "wheel.h"
+
+// a level has 1 << WHEEL_BITS slots and spans WHEEL_BITS more bits of the tick
+#define WHEEL_BITS 8
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS 4
+// items further out wait in the top level and are placed again when it cascades
+#define WHEEL_SPAN (1LL << (WHEEL_BITS * WHEEL_LEVELS))
+// occupancy bitmap of a level, in 64 bit words
+#define WHEEL_WORDS (WHEEL_SLOTS / 64)
+#define WHEEL_FIRST_ITEMS 64
+
+// end of a list, and what a free item is in
+#define NIL -1
+
+typedef struct __item {
+	long long expires;
+	long long period;
+	void *data;
+	int next;
+	int prev;
+	// level * WHEEL_SLOTS + slot, NIL while free
+	int slot;
+	// bumped on every free, so stale ids don't match
+	int generation;
+} t_item, *p_item;
+
+typedef struct __wheel {
+	long long now;
+	// grown by doubling, lists link indexes so they survive the realloc
+	p_item items;
+	int capacity;
+	int free_list;
+	int count;
+	int heads[WHEEL_LEVELS * WHEEL_SLOTS];
+	// a bit per non-empty slot, finds the next one without walking them all
+	unsigned long long occupied[WHEEL_LEVELS][WHEEL_WORDS];
+} t_wheel, *p_wheel;
+
+
+	/*	Prototypes	*/
+
+p_wheel wheel_create(long long now);
+void wheel_destroy(p_wheel wheel);
+long long wheel_add(p_wheel wheel, long long expires, long long period, void *data);
+int wheel_cancel(p_wheel wheel, long long id, void **data);
+void wheel_advance(p_wheel wheel, long long now, void (*expired)(void *, void *), void *ctx);
+long long wheel_next(p_wheel wheel);
+int wheel_count(p_wheel wheel);
+
+static int item_alloc(p_wheel wheel);
+static void item_free(p_wheel wheel, int index);
+static void item_place(p_wheel wheel, int index);
+static void item_unlink(p_wheel wheel, int index);
+
+static int slot_detach(p_wheel wheel, int slot);
+static int slot_distance(p_wheel wheel, int level, int from);
+static int bit_first(unsigned long long bits);
+
+
+	/*	Wheel functions	*/
+
+p_wheel wheel_create(long long now)
+{
+	p_wheel wheel = calloc(1, sizeof(t_wheel));
+	if (wheel == NULL)
+		return NULL;
+
+	wheel->now = now;
+	wheel->free_list = NIL;
+	for (int i = 0; i < WHEEL_LEVELS * WHEEL_SLOTS; i++)
+		wheel->heads[i] = NIL;
+	return wheel;
+}
+
+void wheel_destroy(p_wheel wheel)
+{
+	if (wheel == NULL)
+		return;
+
+	free(wheel->items);
+	free(wheel);
+}
+
+long long wheel_add(p_wheel wheel, long long expires, long long period, void *data)
+{
+	int index = item_alloc(wheel);
+	if (index == NIL)
+		return -1;
+
+	p_item item = &wheel->items[index];
+	// the slot of now has been emptied already
+	item->expires = expires > wheel->now ? expires : wheel->now + 1;
+	item->period = period > 0 ? period : 0;
+	item->data = data;
+	item_place(wheel, index);
+	wheel->count++;
+	return ((long long)item->generation << 32) | index;
+}
+
+int wheel_cancel(p_wheel wheel, long long id, void **data)
+{
+	long long index = id & 0xffffffffLL;
+	if (id <= 0 || index >= wheel->capacity)
+		return -1;
+
+	p_item item = &wheel->items[index];
+	if (item->slot == NIL || item->generation != (int)(id >> 32))
+		return -1;
+
+	if (data != NULL)
+		*data = item->data;
+	item_unlink(wheel, (int)index);
+	item_free(wheel, (int)index);
+	return 0;
+}
+
+/*
+ * Jumps from one tick where something happens to the next,
+ * the ticks in between are never visited
+ */
+void wheel_advance(p_wheel wheel, long long now, void (*expired)(void *, void *), void *ctx)
+{
+	while (wheel->now < now) {
+		long long tick = wheel_next(wheel);
+		if (tick < 0 || tick > now) {
+			wheel->now = now;
+			return;
+		}
+		wheel->now = tick;
+
+		// the highest level first, what it lets down may land in the lower ones
+		int level = 0;
+		while (level + 1 < WHEEL_LEVELS && (tick & ((1LL << (WHEEL_BITS * (level + 1))) - 1)) == 0)
+			level++;
+		for (; level > 0; level--) {
+			int index = slot_detach(wheel, level * WHEEL_SLOTS + (int)((tick >> (WHEEL_BITS * level)) & WHEEL_MASK));
+			while (index != NIL) {
+				int next = wheel->items[index].next;
+				item_place(wheel, index);
+				index = next;
+			}
+		}
+
+		int index = slot_detach(wheel, (int)(tick & WHEEL_MASK));
+		while (index != NIL) {
+			p_item item = &wheel->items[index];
+			int next = item->next;
+			void *data = item->data;
+			if (item->period > 0) {
+				item->expires += item->period;
+				item_place(wheel, index);
+			} else
+				item_free(wheel, index);
+			expired(data, ctx);
+			index = next;
+		}
+	}
+}
+
+long long wheel_next(p_wheel wheel)
+{
+	if (wheel->count == 0)
+		return -1;
+
+	long long next = -1;
+	for (int level = 0; level < WHEEL_LEVELS; level++) {
+		int shift = WHEEL_BITS * level;
+		int distance = slot_distance(wheel, level, (int)((wheel->now >> shift) & WHEEL_MASK));
+		if (distance == 0)
+			continue;
+
+		// a level 0 slot expires, the others cascade where their span starts
+		long long tick = ((wheel->now >> shift) + distance) << shift;
+		if (next < 0 || tick < next)
+			next = tick;
+	}
+	return next;
+}
+
+int wheel_count(p_wheel wheel)
+{
+	return wheel->count;
+}
+
+	/*	Item functions	*/
+
+/*
+ * Returns:
+ *	NIL on error
+ */
+static int item_alloc(p_wheel wheel)
+{
+	if (wheel->free_list == NIL) {
+		int capacity = wheel->capacity > 0 ? wheel->capacity * 2 : WHEEL_FIRST_ITEMS;
+		p_item items = realloc(wheel->items, capacity * sizeof(t_item));
+		if (items == NULL) {
+			fprintf(stderr, "item_alloc: realloc\n");
+			return NIL;
+		}
+		for (int i = capacity - 1; i >= wheel->capacity; i--) {
+			items[i].slot = NIL;
+			items[i].generation = 1;
+			items[i].next = wheel->free_list;
+			wheel->free_list = i;
+		}
+		wheel->items = items;
+		wheel->capacity = capacity;
+	}
+
+	int index = wheel->free_list;
+	wheel->free_list = wheel->items[index].next;
+	return index;
+}
+
+static void item_free(p_wheel wheel, int index)
+{
+	p_item item = &wheel->items[index];
+	item->slot = NIL;
+	// ids stay positive
+	item->generation = item->generation == 0x7fffffff ? 1 : item->generation + 1;
+	item->next = wheel->free_list;
+	wheel->free_list = index;
+	wheel->count--;
+}
+
+/*
+ * The lowest level whose span covers it from now,
+ * in the slot of its expiry's digit at that level.
+ * One due right now, let down on the tick its span starts,
+ * lands in the level 0 slot wheel_advance empties next
+ */
+static void item_place(p_wheel wheel, int index)
+{
+	p_item item = &wheel->items[index];
+	long long expires = item->expires;
+	if (expires - wheel->now >= WHEEL_SPAN)
+		expires = wheel->now + WHEEL_SPAN - 1;
+	long long delta = expires - wheel->now;
+
+	int level = 0;
+	while (delta >= 1LL << (WHEEL_BITS * (level + 1)))
+		level++;
+	int digit = (int)((expires >> (WHEEL_BITS * level)) & WHEEL_MASK);
+	int slot = level * WHEEL_SLOTS + digit;
+
+	item->slot = slot;
+	item->prev = NIL;
+	item->next = wheel->heads[slot];
+	if (item->next != NIL)
+		wheel->items[item->next].prev = index;
+	wheel->heads[slot] = index;
+	wheel->occupied[level][digit / 64] |= 1ULL << (digit % 64);
+}
+
+static void item_unlink(p_wheel wheel, int index)
+{
+	p_item item = &wheel->items[index];
+	if (item->prev != NIL)
+		wheel->items[item->prev].next = item->next;
+	else
+		wheel->heads[item->slot] = item->next;
+	if (item->next != NIL)
+		wheel->items[item->next].prev = item->prev;
+
+	if (wheel->heads[item->slot] == NIL) {
+		int digit = item->slot % WHEEL_SLOTS;
+		wheel->occupied[item->slot / WHEEL_SLOTS][digit / 64] &= ~(1ULL << (digit % 64));
+	}
+}
+
+	/*	Slot functions	*/
+
+/*
+ * Empties the slot
+ * Returns:
+ *	the first item of what was in it
+ */
+static int slot_detach(p_wheel wheel, int slot)
+{
+	int index = wheel->heads[slot];
+	int digit = slot % WHEEL_SLOTS;
+	wheel->heads[slot] = NIL;
+	wheel->occupied[slot / WHEEL_SLOTS][digit / 64] &= ~(1ULL << (digit % 64));
+	return index;
+}
+
+/*
+ * How far the next non-empty slot after from is, going round
+ * Returns:
+ *	0 if the level is empty
+ *	1 to WHEEL_SLOTS otherwise, from itself being the farthest
+ */
+static int slot_distance(p_wheel wheel, int level, int from)
+{
+	const unsigned long long *bits = wheel->occupied[level];
+	int start = (from + 1) & WHEEL_MASK;
+
+	// the first word once more at the end, for what is below start in it
+	for (int i = 0; i <= WHEEL_WORDS; i++) {
+		int word = (start / 64 + i) % WHEEL_WORDS;
+		unsigned long long set = bits[word];
+		if (i == 0)
+			set &= ~0ULL << (start % 64);
+		if (set != 0)
+			return ((word * 64 + bit_first(set) - from - 1) & WHEEL_MASK) + 1;
+	}
+	return 0;
+}
+
+static int bit_first(unsigned long long bits)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_ctzll(bits);
+#else
+	int first = 0;
+	while (!(bits & 1)) {
+		bits >>= 1;
+		first++;
+	}
+	return first;
+#endif
+}
@@ -0,0 +1,60 @@
+#ifndef H_WHEEL
+#define H_WHEEL
+/*
+ * Hierarchical timing wheel over ticks, a count the owner defines.
+ * Adding and cancelling is O(1), an item is moved down a level
+ * at most once per level before it expires.
+ *
+ * Not synchronized, the owner locks it.
+ */
+typedef struct __wheel* wheel;
+
+/*
+ * Returns:
+ *	NULL on error
+ */
+wheel wheel_create(long long now);
+
+/*
+ * Items still in the wheel are dropped
+ */
+void wheel_destroy(wheel);
+
+/*
+ * Expires at the tick, the next one if it is not in the future.
+ * A period above 0 puts it back that many ticks later every time.
+ * Returns:
+ *	-1 on error
+ *	an id above 0 otherwise, never reused
+ */
+long long wheel_add(wheel, long long expires, long long period, void *data);
+
+/*
+ * Takes the item out, its data goes to *data unless that is NULL
+ * Returns:
+ *	-1 if it expired (and had no period) or was cancelled already
+ *	0 otherwise
+ */
+int wheel_cancel(wheel, long long id, void **data);
+
+/*
+ * Moves the wheel up to now, calling expired for every item that expires on the way.
+ * Periodic items are back in the wheel by then and may be cancelled from it
+ */
+void wheel_advance(wheel, long long now, void (*expired)(void *data, void *ctx), void *ctx);
+
+/*
+ * Nothing happens before it: no item expires, and none is due to move down a level
+ * Returns:
+ *	-1 if the wheel is empty
+ *	the tick otherwise
+ */
+long long wheel_next(wheel);
+
+/*
+ * Returns:
+ *	items in the wheel
+ */
+int wheel_count(wheel);
+
+#endif